@@ -67,6 +67,14 @@ sys_mutex_t lock_tcpip_core;
 
 static void tcpip_thread_handle_msg(struct tcpip_msg *msg);
 
+#if LWIP_TCPIP_MBOX_HI
+/* received packets overtake queued API calls and callbacks. Everything else
+   stays in the normal queue so it is handled in the order it was posted. */
+#define TCPIP_MBOX_TRYPOST_HI(mbox, msg) sys_mbox_trypost_prio(mbox, msg)
+#else /* LWIP_TCPIP_MBOX_HI */
+#define TCPIP_MBOX_TRYPOST_HI(mbox, msg) sys_mbox_trypost(mbox, msg)
+#endif /* LWIP_TCPIP_MBOX_HI */
+
 #if !LWIP_TIMERS
 /* wait for a message with timers disabled (e.g. pass a timer-check trigger into tcpip_thread) */
 #define TCPIP_MBOX_FETCH(mbox, msg) sys_mbox_fetch(mbox, msg)
@@ -260,7 +268,7 @@ tcpip_inpkt(struct pbuf *p, struct netif *inp, netif_input_fn input_fn)
   msg->msg.inp.p = p;
   msg->msg.inp.netif = inp;
   msg->msg.inp.input_fn = input_fn;
-  if (sys_mbox_trypost(&tcpip_mbox, msg) != ERR_OK) {
+  if (TCPIP_MBOX_TRYPOST_HI(&tcpip_mbox, msg) != ERR_OK) {
     memp_free(MEMP_TCPIP_MSG_INPKT, msg);
     return ERR_MEM;
   }
@@ -605,7 +613,11 @@ tcpip_init(tcpip_init_done_fn initfunc, void *arg)
 
   tcpip_init_done = initfunc;
   tcpip_init_done_arg = arg;
+#if LWIP_TCPIP_MBOX_HI
+  if (sys_mbox_new_prio(&tcpip_mbox, TCPIP_MBOX_SIZE, TCPIP_MBOX_HI_SIZE) != ERR_OK) {
+#else /* LWIP_TCPIP_MBOX_HI */
   if (sys_mbox_new(&tcpip_mbox, TCPIP_MBOX_SIZE) != ERR_OK) {
+#endif /* LWIP_TCPIP_MBOX_HI */
     LWIP_ASSERT("failed to create tcpip_thread mbox", 0);
   }
 #if LWIP_TCPIP_CORE_LOCKING
@@ -617,6 +629,24 @@ tcpip_init(tcpip_init_done_fn initfunc, void *arg)
   sys_thread_new(TCPIP_THREAD_NAME, tcpip_thread, NULL, TCPIP_THREAD_STACKSIZE, TCPIP_THREAD_PRIO);
 }
 
+#if LWIP_TCPIP_MBOX_HI
+/**
+ * @ingroup lwip_os
+ * Read the current and maximum depth of both tcpip_thread queues.
+ *
+ * @param api pending API calls and callbacks (normal queue)
+ * @param rx pending received packets (high priority queue)
+ * @param api_max maximum depth seen on the normal queue
+ * @param rx_max maximum depth seen on the high priority queue
+ */
+void
+tcpip_get_mbox_depth(u16_t *api, u16_t *rx, u16_t *api_max, u16_t *rx_max)
+{
+  LWIP_ASSERT("Invalid mbox", sys_mbox_valid_val(tcpip_mbox));
+  sys_mbox_get_depth(&tcpip_mbox, api, rx, api_max, rx_max);
+}
+#endif /* LWIP_TCPIP_MBOX_HI */
+
 /**
  * Simple callback function used with tcpip_callback to free a pbuf
  * (pbuf_free has a wrong signature for tcpip_callback)
@@ -36,7 +36,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 
-typedef int sys_prot_t;
+typedef unsigned int sys_prot_t;   //保存进入临界区前的BASEPRI
 
 #define LWIP_PROVIDE_ERRNO
 
@@ -85,6 +85,30 @@ typedef int sys_prot_t;
 /* Define random number generator function */
 #define LWIP_RAND() ((u32_t)rand())
 
+/* 内存放置：只有CPU访问的内存池(PCB、定时器、netconn、netbuf等)放到LWIP_CCM_SECTION，
+ * 以太网DMA要读写的堆(PBUF_RAM)、PBUF_POOL和驱动接收缓冲区池放到LWIP_DMA_SECTION，
+ * 两者在lwipopts.h中定义，默认为空 */
+#ifndef LWIP_CCM_SECTION
+#define LWIP_CCM_SECTION
+#endif
+#ifndef LWIP_DMA_SECTION
+#define LWIP_DMA_SECTION
+#endif
+#define LWIP_DECLARE_MEMORY_ALIGNED(variable_name, size)      u8_t variable_name[LWIP_MEM_ALIGN_BUFFER(size)] LWIP_CCM_SECTION
+#define LWIP_DECLARE_DMA_MEMORY_ALIGNED(variable_name, size)  u8_t variable_name[LWIP_MEM_ALIGN_BUFFER(size)] LWIP_DMA_SECTION
+
+/* 校验和：使用chksum.c中按32位字累加的实现替代lwip_standard_chksum()，
+ * 复制数据时用lwip_copy_chksum()一边复制一边求和，替代先MEMCPY再求和的lwip_chksum_copy()。
+ * 在lwipopts.h中定义LWIP_CHKSUM、LWIP_CHKSUM_COPY可以换回其他实现 */
+#ifndef LWIP_CHKSUM
+#define LWIP_CHKSUM lwip_cm4_chksum
+unsigned short lwip_cm4_chksum(const void *dataptr, int len);
+#endif
+#ifndef LWIP_CHKSUM_COPY
+#define LWIP_CHKSUM_COPY(dst, src, len) lwip_copy_chksum(dst, src, len)
+#endif
+unsigned short lwip_copy_chksum(void *dst, const void *src, unsigned short len);
+
 /* User predefine */
 #define LWIP_NOASSERT       //在这里预定义宏来关闭ASSERT功能，printf函数没有实现，因此先不适用ASSERT
 
@@ -0,0 +1,304 @@
+/**
+ * @file
+ * Internet checksum for Cortex-M4, selected with LWIP_CHKSUM and LWIP_CHKSUM_COPY in cc.h
+ *
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#include "lwip/def.h"
+#include "lwip/inet_chksum.h"
+
+#include <string.h>
+
+/* 以32位字为单位求反码和：进位加回到和的最低位(end-around carry)，折叠成16位后和按16位求和的结果相同。
+ * 调用时p必须4字节对齐，cnt为字数。copy_chksum_words()同时把数据复制到dst，dst也必须4字节对齐 */
+#if defined(__CC_ARM)
+
+/* LDM一次取4个字，ADCS把上一次加法的进位带进来，每次加4个字节只需要一个周期。
+ * 一串ADDS/ADCS开头的加法不会出现和为0xFFFFFFFF且有进位的情况，最后的ADC #0不会丢进位 */
+__asm static u32_t
+chksum_words(const u32_t *p, u32_t cnt, u32_t sum)
+{
+        PUSH    {r4, r5}
+        SUBS    r1, r1, #8
+        BLO     chksum_words_tail
+chksum_words_loop8
+        LDMIA   r0!, {r3-r5, r12}
+        ADDS    r2, r2, r3
+        ADCS    r2, r2, r4
+        ADCS    r2, r2, r5
+        ADCS    r2, r2, r12
+        LDMIA   r0!, {r3-r5, r12}
+        ADCS    r2, r2, r3
+        ADCS    r2, r2, r4
+        ADCS    r2, r2, r5
+        ADCS    r2, r2, r12
+        ADC     r2, r2, #0
+        SUBS    r1, r1, #8
+        BHS     chksum_words_loop8
+chksum_words_tail
+        ADDS    r1, r1, #8
+        BEQ     chksum_words_done
+chksum_words_loop1
+        LDR     r3, [r0], #4
+        ADDS    r2, r2, r3
+        ADC     r2, r2, #0
+        SUBS    r1, r1, #1
+        BNE     chksum_words_loop1
+chksum_words_done
+        MOV     r0, r2
+        POP     {r4, r5}
+        BX      lr
+}
+
+/* 同上，读出的4个字用STM写到dst，数据只经过寄存器一次 */
+__asm static u32_t
+copy_chksum_words(u32_t *dst, const u32_t *src, u32_t cnt, u32_t sum)
+{
+        PUSH    {r4-r7}
+        SUBS    r2, r2, #4
+        BLO     copy_chksum_words_tail
+copy_chksum_words_loop4
+        LDMIA   r1!, {r4-r7}
+        STMIA   r0!, {r4-r7}
+        ADDS    r3, r3, r4
+        ADCS    r3, r3, r5
+        ADCS    r3, r3, r6
+        ADCS    r3, r3, r7
+        ADC     r3, r3, #0
+        SUBS    r2, r2, #4
+        BHS     copy_chksum_words_loop4
+copy_chksum_words_tail
+        ADDS    r2, r2, #4
+        BEQ     copy_chksum_words_done
+copy_chksum_words_loop1
+        LDR     r4, [r1], #4
+        STR     r4, [r0], #4
+        ADDS    r3, r3, r4
+        ADC     r3, r3, #0
+        SUBS    r2, r2, #1
+        BNE     copy_chksum_words_loop1
+copy_chksum_words_done
+        MOV     r0, r3
+        POP     {r4-r7}
+        BX      lr
+}
+
+/* Cortex-M4的LDR/STR支持非对齐访问，__packed指针编译成单条非对齐STR */
+#define CHKSUM_STORE_U32(dst, w)  (*(__packed u32_t *)(dst) = (w))
+
+#else /* __CC_ARM */
+
+/* 其他编译器：64位累加，Cortex-M上编译成ADDS/ADC，最后把高32位的进位加回来 */
+static u32_t
+chksum_words(const u32_t *p, u32_t cnt, u32_t sum)
+{
+  u64_t acc = sum;
+
+  while (cnt >= 4) {
+    acc += p[0];
+    acc += p[1];
+    acc += p[2];
+    acc += p[3];
+    p += 4;
+    cnt -= 4;
+  }
+  while (cnt > 0) {
+    acc += *p++;
+    cnt--;
+  }
+
+  acc = (acc & 0xffffffffUL) + (acc >> 32);
+  acc = (acc & 0xffffffffUL) + (acc >> 32);
+  return (u32_t)acc;
+}
+
+static u32_t
+copy_chksum_words(u32_t *dst, const u32_t *src, u32_t cnt, u32_t sum)
+{
+  u64_t acc = sum;
+  u32_t w;
+
+  while (cnt > 0) {
+    w = *src++;
+    *dst++ = w;
+    acc += w;
+    cnt--;
+  }
+
+  acc = (acc & 0xffffffffUL) + (acc >> 32);
+  acc = (acc & 0xffffffffUL) + (acc >> 32);
+  return (u32_t)acc;
+}
+
+/* 编译器把4字节的memcpy展开成一条非对齐STR */
+#define CHKSUM_STORE_U32(dst, w)  do { u32_t w_ = (w); memcpy((dst), &w_, 4); } while(0)
+
+#endif /* __CC_ARM */
+
+/* src已经4字节对齐而dst没有对齐时(例如应用数据拷贝到pbuf)，逐字读取后非对齐写入 */
+static u32_t
+copy_chksum_words_unaligned(u8_t *dst, const u32_t *src, u32_t cnt, u32_t sum)
+{
+  u64_t acc = sum;
+  u32_t w;
+
+  while (cnt > 0) {
+    w = *src++;
+    CHKSUM_STORE_U32(dst, w);
+    dst += 4;
+    acc += w;
+    cnt--;
+  }
+
+  acc = (acc & 0xffffffffUL) + (acc >> 32);
+  acc = (acc & 0xffffffffUL) + (acc >> 32);
+  return (u32_t)acc;
+}
+
+/**
+ * 求数据的16位反码和，pd不为NULL时同时把数据复制到pd。
+ * 起始地址为奇数时先取一个字节，最后把结果的高低字节交换；再取一个半字让源地址对齐到4字节，
+ * 中间部分按32位字累加，剩下的半字和单字节单独处理。
+ *
+ * @param pd 复制的目的地址，可以不对齐，为NULL时只求和
+ * @param ps 数据起始地址，可以不对齐
+ * @param len 数据长度(字节)
+ * @return 16位反码和(主机字节序，未取反)
+ */
+static u16_t
+chksum_copy(u8_t *pd, const u8_t *ps, int len)
+{
+  u32_t sum = 0;
+  u32_t words;
+  u16_t t = 0;
+  u16_t h;
+  int odd = ((mem_ptr_t)ps & 1);
+
+  /* 奇数地址的第一个字节放在高8位，最后交换字节后回到正确的位置 */
+  if (odd && (len > 0)) {
+    ((u8_t *)&t)[1] = *ps;
+    if (pd != NULL) {
+      *pd++ = *ps;
+    }
+    ps++;
+    len--;
+  }
+
+  /* ps已经2字节对齐，再取一个半字对齐到4字节 */
+  if (((mem_ptr_t)ps & 2) && (len >= 2)) {
+    h = *(const u16_t *)(const void *)ps;
+    sum += h;
+    if (pd != NULL) {
+      SMEMCPY(pd, &h, 2);
+      pd += 2;
+    }
+    ps += 2;
+    len -= 2;
+  }
+
+  words = (u32_t)len >> 2;
+  if (words > 0) {
+    if (pd == NULL) {
+      sum = chksum_words((const u32_t *)(const void *)ps, words, sum);
+    } else {
+      if (((mem_ptr_t)pd & 3) == 0) {
+        sum = copy_chksum_words((u32_t *)(void *)pd, (const u32_t *)(const void *)ps, words, sum);
+      } else {
+        sum = copy_chksum_words_unaligned(pd, (const u32_t *)(const void *)ps, words, sum);
+      }
+      pd += words << 2;
+    }
+    ps += words << 2;
+    len &= 3;
+  }
+  sum = FOLD_U32T(sum);
+
+  if (len >= 2) {
+    h = *(const u16_t *)(const void *)ps;
+    sum += h;
+    if (pd != NULL) {
+      SMEMCPY(pd, &h, 2);
+      pd += 2;
+    }
+    ps += 2;
+    len -= 2;
+  }
+
+  /* 最后剩下的单字节放在低8位 */
+  if (len > 0) {
+    ((u8_t *)&t)[0] = *ps;
+    if (pd != NULL) {
+      *pd = *ps;
+    }
+  }
+  sum += t;
+
+  sum = FOLD_U32T(sum);
+  sum = FOLD_U32T(sum);
+
+  if (odd) {
+    sum = SWAP_BYTES_IN_WORD(sum);
+  }
+
+  return (u16_t)sum;
+}
+
+/**
+ * 替代lwip_standard_chksum()，返回值相同(主机字节序，未取反)
+ *
+ * @param dataptr 数据起始地址，可以不对齐
+ * @param len 数据长度(字节)
+ * @return 16位反码和
+ */
+u16_t
+lwip_cm4_chksum(const void *dataptr, int len)
+{
+  return chksum_copy(NULL, (const u8_t *)dataptr, len);
+}
+
+/**
+ * 复制数据的同时求16位反码和，数据只读一遍，替代lwip_chksum_copy()的先MEMCPY再LWIP_CHKSUM。
+ * 用于LWIP_CHECKSUM_ON_COPY(应用数据拷贝到pbuf)和驱动把接收帧拷贝到pbuf(LWIP_CHECKSUM_ON_RX_COPY)
+ *
+ * @param dst 目的地址，可以不对齐
+ * @param src 源地址，可以不对齐
+ * @param len 数据长度(字节)
+ * @return 16位反码和，和LWIP_CHKSUM(src, len)相同
+ */
+u16_t
+lwip_copy_chksum(void *dst, const void *src, u16_t len)
+{
+  return chksum_copy((u8_t *)dst, (const u8_t *)src, len);
+}
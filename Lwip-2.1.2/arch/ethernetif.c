@@ -49,6 +49,7 @@
 #include "lwip/def.h"
 #include "lwip/mem.h"
 #include "lwip/pbuf.h"
+#include "lwip/inet_chksum.h"
 #include "lwip/stats.h"
 #include "lwip/snmp.h"
 #include "lwip/ethip6.h"
@@ -78,26 +79,114 @@
 
 #define ETH_RX_TASK_STACK_SIZE    350
 #define ETH_RX_TASK_PRIO          0
+#define ETH_LINK_TASK_STACK_SIZE  256
+#define ETH_LINK_TASK_PRIO        3
 /* 以太网描述符(STM32根据描述符来处理发送和接收的数据包)和发送/接收缓冲区定义 */
 #if defined ( __ICCARM__ ) /*!< IAR Compiler */
   #pragma data_alignment=4   
 #endif
-__ALIGN_BEGIN ETH_DMADescTypeDef  DMARxDscrTab[ETH_RXBUFNB] __ALIGN_END;/* Ethernet Rx MA Descriptor */
+__ALIGN_BEGIN ETH_DMADescTypeDef  DMARxDscrTab[ETHIF_RX_DESC_MAX] __ALIGN_END ETHIF_DMA_SECTION;/* Ethernet Rx MA Descriptor */
 
 #if defined ( __ICCARM__ ) /*!< IAR Compiler */
   #pragma data_alignment=4   
 #endif
-__ALIGN_BEGIN ETH_DMADescTypeDef  DMATxDscrTab[ETH_TXBUFNB] __ALIGN_END;/* Ethernet Tx DMA Descriptor */
+__ALIGN_BEGIN ETH_DMADescTypeDef  DMATxDscrTab[ETHIF_TX_DESC_MAX] __ALIGN_END ETHIF_DMA_SECTION;/* Ethernet Tx DMA Descriptor */
 
+#if !ETHIF_RX_ZERO_COPY
 #if defined ( __ICCARM__ ) /*!< IAR Compiler */
   #pragma data_alignment=4   
 #endif
-__ALIGN_BEGIN uint8_t Rx_Buff[ETH_RXBUFNB][ETH_RX_BUF_SIZE] __ALIGN_END; /* Ethernet Receive Buffer */
+__ALIGN_BEGIN uint8_t Rx_Buff[ETHIF_RX_DESC_MAX][ETH_RX_BUF_SIZE] __ALIGN_END ETHIF_DMA_SECTION; /* Ethernet Receive Buffer */
+#endif /* !ETHIF_RX_ZERO_COPY */
 
 #if defined ( __ICCARM__ ) /*!< IAR Compiler */
   #pragma data_alignment=4   
 #endif
-__ALIGN_BEGIN uint8_t Tx_Buff[ETH_TXBUFNB][ETH_TX_BUF_SIZE] __ALIGN_END; /* Ethernet Transmit Buffer */
+__ALIGN_BEGIN uint8_t Tx_Buff[ETHIF_TX_DESC_MAX][ETH_TX_BUF_SIZE] __ALIGN_END ETHIF_DMA_SECTION; /* Ethernet Transmit Buffer */
+
+/* 实际使用的描述符数量，默认用满上面的数组，可以在netif_add()之前用ethernetif_set_ring_size()修改 */
+static uint32_t RxDescCnt = ETHIF_RX_DESC_MAX;
+static uint32_t TxDescCnt = ETHIF_TX_DESC_MAX;
+
+/* 收发描述符环的统计信息 */
+ETH_RingStatsTypeDef ETH_RingStats;
+
+#if ETHIF_RX_COALESCE
+/* 接收中断合并参数，可以用ethernetif_set_rx_coalesce()在运行时修改 */
+static uint32_t RxCoalesceFrames = ETHIF_RX_COALESCE_FRAMES;
+static uint32_t RxCoalesceUsec = ETHIF_RX_COALESCE_USEC;
+#endif
+
+#if ETHIF_RX_ZERO_COPY
+#if !LWIP_SUPPORT_CUSTOM_PBUF
+#error "ETHIF_RX_ZERO_COPY needs LWIP_SUPPORT_CUSTOM_PBUF"
+#endif
+/* 零拷贝接收缓冲区：pbuf_custom和DMA缓冲区放在一起，由RX_POOL统一管理 */
+typedef struct
+{
+  struct pbuf_custom pc;              /* 必须放在第一个，pbuf_free回调时直接转换 */
+  uint8_t buff[ETH_RX_BUF_SIZE];      /* DMA接收缓冲区，MEM_ALIGNMENT保证4字节对齐 */
+} ETH_RxBufTypeDef;
+
+/* 缓冲区数量多于描述符数量，帧交给协议栈后描述符可以立即换上空闲缓冲区 */
+LWIP_MEMPOOL_DECLARE_DMA(RX_POOL, ETHIF_RX_BUF_CNT, sizeof(ETH_RxBufTypeDef), "Zero-copy RX PBUF pool");
+
+/* 已交给协议栈但还没换上新缓冲区的描述符为[RxRefillIdx, RxRefillIdx + RxEmptyCnt) */
+static uint32_t RxRefillIdx = 0;
+static uint32_t RxEmptyCnt = 0;
+#endif /* ETHIF_RX_ZERO_COPY */
+
+#if ETHIF_TX_ZERO_COPY
+/* 以太网DMA只能访问SRAM1/SRAM2，CCM和Flash中的数据需要拷贝到Tx_Buff后发送 */
+#define ETH_DMA_REACHABLE(addr)   (((uint32_t)(addr) >= SRAM1_BASE) && ((uint32_t)(addr) < (SRAM2_BASE + 0x4000U)))
+
+/* 零拷贝发送：帧的最后一个描述符记录整条pbuf链，DMA发送完成后释放 */
+static struct pbuf *TxPbuf[ETHIF_TX_DESC_MAX];
+/* 还在DMA手里的描述符为[TxReclaimIdx, TxReclaimIdx + TxBusyCnt) */
+static uint32_t TxReclaimIdx = 0;
+static uint32_t TxBusyCnt = 0;
+#endif /* ETHIF_TX_ZERO_COPY */
+
+#if ETHIF_TX_QUEUE_LEN > 0
+/* 发送描述符被DMA占用时帧暂存在软件队列中，发送完成后由以太网任务按顺序发出 */
+static struct pbuf *TxQueue[ETHIF_TX_QUEUE_LEN];
+/* 队列中的帧为[TxQueueHead, TxQueueHead + TxQueueCnt) */
+static uint32_t TxQueueHead = 0;
+static uint32_t TxQueueCnt = 0;
+#endif /* ETHIF_TX_QUEUE_LEN > 0 */
+
+#if ETHIF_PTP
+/* PTP系统时间的亚秒增量(ns)，精细校正模式下累加器以1/ETH_PTP_SSINC GHz的频率溢出，要求HCLK高于这个频率 */
+#define ETH_PTP_SSINC       20U
+
+/* 按pbuf记录的硬件时间戳 */
+typedef struct
+{
+  struct pbuf *p;
+  ETH_PtpTimeTypeDef ts;
+} ETH_PtpRecordTypeDef;
+
+/* 接收/发送时间戳记录表，写满后覆盖最旧的记录 */
+static ETH_PtpRecordTypeDef PtpRxTbl[ETHIF_PTP_TS_CNT];
+static ETH_PtpRecordTypeDef PtpTxTbl[ETHIF_PTP_TS_CNT];
+static uint32_t PtpRxIdx = 0;
+static uint32_t PtpTxIdx = 0;
+/* 发送帧最后一个描述符对应的pbuf，DMA写回时间戳后记录到PtpTxTbl */
+static struct pbuf *PtpTxPbuf[ETHIF_TX_DESC_MAX];
+/* 频率校正为0时的加数寄存器值 */
+static uint32_t PtpAddendBase;
+#endif /* ETHIF_PTP */
+
+/* 零拷贝发送、发送队列和发送时间戳都需要发送完成中断唤醒以太网任务 */
+#define ETHIF_TX_CPLT_IT    (ETHIF_TX_ZERO_COPY || (ETHIF_TX_QUEUE_LEN > 0) || ETHIF_PTP)
+
+/* 打开IGMP或MLD时用MAC的64位哈希表过滤组播帧 */
+#define ETHIF_MCAST_FILTER  (LWIP_IGMP || (LWIP_IPV6 && LWIP_IPV6_MLD))
+
+#if ETHIF_MCAST_FILTER
+/* 哈希表每一位对应的组播地址个数，不同的组可能落在同一位上，计数为0时才清除该位 */
+static uint8_t McastHashRef[64];
+#endif
 
 /* 以太网句柄 */
 extern ETH_HandleTypeDef heth;
@@ -106,6 +195,11 @@ OS_SEM ETH_SemRx;
 /* 以太网接收任务 */
 OS_TCB  ETH_RxTaskTCB;
 CPU_STK ETH_RxTaskSTK[ETH_RX_TASK_STACK_SIZE];
+#if ETHIF_LINK_MONITOR
+/* PHY连接状态监测任务 */
+OS_TCB  ETH_LinkTaskTCB;
+CPU_STK ETH_LinkTaskSTK[ETH_LINK_TASK_STACK_SIZE];
+#endif
 /**
  * Helper struct to hold private data used to operate your ethernet interface.
  * Keeping the ethernet address of the MAC in this struct is not necessary
@@ -119,6 +213,9 @@ CPU_STK ETH_RxTaskSTK[ETH_RX_TASK_STACK_SIZE];
 
 /* Forward declarations. */
 // static void  ethernetif_input(struct netif *netif);
+#if ETHIF_LINK_MONITOR
+static void  ethernetif_link_thread(void *p_arg);
+#endif
 
 /**
   * @brief  Ethernet Rx Transfer completed callback
@@ -129,11 +226,670 @@ void HAL_ETH_RxCpltCallback(ETH_HandleTypeDef *heth)
 {
   OS_ERR err;
 
+#if ETHIF_RX_BATCH
+  /* HAL_ETH_IRQHandler()只看RS标志，不看RIE。接收中断关闭期间发送完成等其他中断进来时，
+     RS还没清除也会调用这里，这时以太网任务已经唤醒、还在取接收队列，不计数也不再释放信号量。
+     RS由HAL清除，任务重新打开接收中断后会再检查一次接收队列，不会漏帧 */
+  if ((heth->Instance->DMAIER & ETH_DMA_IT_R) == 0u)
+  {
+    return;
+  }
+  /* 批量接收时由以太网任务取空接收队列后再打开接收中断 */
+  __HAL_ETH_DMA_DISABLE_IT(heth, ETH_DMA_IT_R);
+#endif
+  ETH_RingStats.RxIrq++;
   OSSemPost(&ETH_SemRx,
             OS_OPT_POST_1,
             &err);
 }
 
+/**
+ * 记录接收环中等待处理的描述符数量的最大值，从heth.RxDesc开始数OWN位为0的描述符。
+ */
+static void
+ethernetif_rx_hiwater(void)
+{
+  ETH_DMADescTypeDef *dmarxdesc = heth.RxDesc;
+  uint32_t limit = RxDescCnt;
+  uint32_t count = 0;
+
+#if ETHIF_RX_ZERO_COPY
+  /* 等待补充缓冲区的描述符OWN位也为0，不计入 */
+  limit -= RxEmptyCnt;
+#endif
+  while ((count < limit) && ((dmarxdesc->Status & ETH_DMARXDESC_OWN) == (uint32_t)RESET))
+  {
+    count++;
+    dmarxdesc = (ETH_DMADescTypeDef *)(dmarxdesc->Buffer2NextDescAddr);
+  }
+  if (count > ETH_RingStats.RxHighWater)
+  {
+    ETH_RingStats.RxHighWater = count;
+  }
+}
+
+/**
+ * 记录发送环中被DMA持有的描述符数量的最大值，在帧交给DMA之后调用。
+ */
+static void
+ethernetif_tx_hiwater(void)
+{
+  uint32_t i;
+  uint32_t count = 0;
+
+  for (i = 0; i < TxDescCnt; i++)
+  {
+    if ((DMATxDscrTab[i].Status & ETH_DMATXDESC_OWN) != (uint32_t)RESET)
+    {
+      count++;
+    }
+  }
+  if (count > ETH_RingStats.TxHighWater)
+  {
+    ETH_RingStats.TxHighWater = count;
+  }
+}
+
+/**
+ * 根据网卡的校验和控制标志选择发送描述符的CIC位。
+ * 协议栈没有计算的校验和交给MAC插入，已经计算过的让MAC旁路。
+ * MAC不修改IP分片的TCP/UDP/ICMP校验和，所以UDP和ICMP仍由协议栈计算，
+ * 全硬件模式下不分片的帧由MAC重新计算，分片则保留协议栈算好的值。
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @return 写入TDES0的ETH_DMATXDESC_CHECKSUMxxx
+ */
+static uint32_t
+ethernetif_tx_cic(struct netif *netif)
+{
+#if CHECKSUM_BY_HARDWARE
+  if ((netif->chksum_flags & (NETIF_CHECKSUM_GEN_TCP | NETIF_CHECKSUM_GEN_UDP | NETIF_CHECKSUM_GEN_ICMP)) !=
+      (NETIF_CHECKSUM_GEN_TCP | NETIF_CHECKSUM_GEN_UDP | NETIF_CHECKSUM_GEN_ICMP))
+  {
+    /* 全硬件模式同时插入IP首部校验和，伪首部也由MAC计算 */
+    return ETH_DMATXDESC_CHECKSUMTCPUDPICMPFULL;
+  }
+  if ((netif->chksum_flags & NETIF_CHECKSUM_GEN_IP) == 0)
+  {
+    return ETH_DMATXDESC_CHECKSUMIPV4HEADER;
+  }
+#else
+  LWIP_UNUSED_ARG(netif);
+#endif /* CHECKSUM_BY_HARDWARE */
+  return ETH_DMATXDESC_CHECKSUMBYPASS;
+}
+
+#if CHECKSUM_BY_HARDWARE
+/**
+ * 检查当前接收帧的硬件校验结果。
+ * 使用增强型描述符时RDES0的bit0(ETH_DMARXDESC_MAMPCE)是ESA，表示RDES4中的
+ * 扩展状态有效，IP首部和TCP/UDP/ICMP校验错误记录在最后一个描述符的RDES4中。
+ *
+ * @return 1 校验错误，帧需要丢弃
+ */
+static int
+ethernetif_rx_chkerr(void)
+{
+  ETH_DMADescTypeDef *lsdesc = heth.RxFrameInfos.LSRxDesc;
+
+  if ((lsdesc->Status & ETH_DMARXDESC_MAMPCE) == (uint32_t)RESET)
+  {
+    return 0;
+  }
+  return ((lsdesc->ExtendedStatus & (ETH_DMAPTPRXDESC_IPHE | ETH_DMAPTPRXDESC_IPPE)) != 0);
+}
+
+/**
+ * 检查MAC是否验证过当前接收帧的TCP/UDP/ICMP校验和。
+ * MAC不检查IP分片和带有不支持的扩展首部的帧的负载，这时IPPT为0或IPCB置位，
+ * 这些帧(以及分片重组后的数据报)仍由协议栈计算校验和。
+ *
+ * @return 1 负载校验和已由MAC验证
+ */
+static int
+ethernetif_rx_chkok(void)
+{
+  ETH_DMADescTypeDef *lsdesc = heth.RxFrameInfos.LSRxDesc;
+  uint32_t ext;
+
+  if ((lsdesc->Status & ETH_DMARXDESC_MAMPCE) == (uint32_t)RESET)
+  {
+    return 0;
+  }
+  ext = lsdesc->ExtendedStatus;
+  return (((ext & (ETH_DMAPTPRXDESC_IPV4PR | ETH_DMAPTPRXDESC_IPV6PR)) != 0) &&
+          ((ext & ETH_DMAPTPRXDESC_IPPT) != 0) &&
+          ((ext & (ETH_DMAPTPRXDESC_IPCB | ETH_DMAPTPRXDESC_IPPE)) == 0));
+}
+#endif /* CHECKSUM_BY_HARDWARE */
+
+#if ETHIF_RX_COALESCE
+/**
+ * 设置接收中断合并：每RxCoalesceFrames个描述符中只有最后一个在接收完成时产生中断，
+ * 其余描述符设置DIC位，由接收状态看门狗(DMARSWTR)在RxCoalesceUsec后补发中断。
+ * HAL_ETH_Init()会复位DMARSWTR，之后需要重新调用。
+ */
+static void
+ethernetif_rx_coalesce_apply(void)
+{
+  uint32_t i;
+  uint32_t rswtc;
+
+  for (i = 0; i < RxDescCnt; i++)
+  {
+    if (((i + 1) % RxCoalesceFrames) == 0)
+    {
+      DMARxDscrTab[i].ControlBufferSize &= ~ETH_DMARXDESC_DIC;
+    }
+    else
+    {
+      DMARxDscrTab[i].ControlBufferSize |= ETH_DMARXDESC_DIC;
+    }
+  }
+
+  /* 看门狗计数单位为256个HCLK周期，168MHz时约1.5us，最大255 */
+  rswtc = (RxCoalesceUsec * (HAL_RCC_GetHCLKFreq() / 1000000U) + 255U) / 256U;
+  __HAL_ETH_SET_RECEIVE_WATCHDOG_TIMER(&heth, LWIP_MIN(LWIP_MAX(rswtc, 1U), 255U));
+}
+#endif /* ETHIF_RX_COALESCE */
+
+#if ETHIF_PTP
+/**
+ * 初始化PTP时间戳单元：亚秒寄存器按ns计数(数字翻转)，精细校正模式，所有接收帧都记录时间戳。
+ * HAL_ETH_Init()会复位MAC，之后需要重新调用。
+ */
+static void
+ethernetif_ptp_init(void)
+{
+  ETH_TypeDef *eth = heth.Instance;
+
+  /* 不使用目标时间触发中断 */
+  eth->MACIMR |= ETH_MACIMR_TSTIM;
+
+  /* CMSIS把TSSARFE/TSSSR定义在PTPTSSR名下，这两位实际位于PTPTSCR */
+  eth->PTPTSCR = ETH_PTPTSCR_TSE | ETH_PTPTSSR_TSSARFE | ETH_PTPTSSR_TSSSR;
+  eth->PTPSSIR = ETH_PTP_SSINC;
+
+  /* addend = 2^32 * (1 / ETH_PTP_SSINC GHz) / HCLK */
+  PtpAddendBase = (uint32_t)((((uint64_t)(1000000000U / ETH_PTP_SSINC)) << 32) / HAL_RCC_GetHCLKFreq());
+  eth->PTPTSAR = PtpAddendBase;
+  eth->PTPTSCR |= ETH_PTPTSCR_TSARU;
+  while ((eth->PTPTSCR & ETH_PTPTSCR_TSARU) != (uint32_t)RESET)
+  {
+  }
+  eth->PTPTSCR |= ETH_PTPTSCR_TSFCU;
+
+  eth->PTPTSHUR = 0;
+  eth->PTPTSLUR = 0;
+  eth->PTPTSCR |= ETH_PTPTSCR_TSSTI;
+  while ((eth->PTPTSCR & ETH_PTPTSCR_TSSTI) != (uint32_t)RESET)
+  {
+  }
+}
+
+/**
+ * 记录一个时间戳，表写满后覆盖最旧的记录。
+ */
+static void
+ethernetif_ptp_record(ETH_PtpRecordTypeDef *tbl, uint32_t *idx, struct pbuf *p, const ETH_PtpTimeTypeDef *ts)
+{
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  SYS_ARCH_PROTECT(old_level);
+  tbl[*idx].p = p;
+  tbl[*idx].ts = *ts;
+  *idx = (*idx + 1) % ETHIF_PTP_TS_CNT;
+  SYS_ARCH_UNPROTECT(old_level);
+}
+
+/**
+ * 查找pbuf对应的时间戳。从最新的记录开始找，pbuf释放后地址被重用时以最新的为准。
+ */
+static err_t
+ethernetif_ptp_lookup(const ETH_PtpRecordTypeDef *tbl, const uint32_t *idx, struct pbuf *p, ETH_PtpTimeTypeDef *ts)
+{
+  uint32_t i;
+  uint32_t pos;
+  err_t errval = ERR_VAL;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  SYS_ARCH_PROTECT(old_level);
+  pos = *idx;
+  for (i = 0; i < ETHIF_PTP_TS_CNT; i++)
+  {
+    pos = (pos + ETHIF_PTP_TS_CNT - 1) % ETHIF_PTP_TS_CNT;
+    if (tbl[pos].p == p)
+    {
+      *ts = tbl[pos].ts;
+      errval = ERR_OK;
+      break;
+    }
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+  return errval;
+}
+
+/**
+ * 取出当前接收帧的时间戳，需要在描述符归还DMA之前调用。
+ * 使用增强型描述符并打开时间戳时RDES0的bit7(ETH_DMARXDESC_IPV4HCE)是TSV。
+ *
+ * @return 1 时间戳有效
+ */
+static int
+ethernetif_ptp_rx_stamp(ETH_PtpTimeTypeDef *ts)
+{
+  ETH_DMADescTypeDef *lsdesc = heth.RxFrameInfos.LSRxDesc;
+
+  if ((lsdesc->Status & ETH_DMARXDESC_IPV4HCE) == (uint32_t)RESET)
+  {
+    return 0;
+  }
+  ts->Seconds = lsdesc->TimeStampHigh;
+  ts->NanoSeconds = lsdesc->TimeStampLow;
+  return 1;
+}
+
+/**
+ * 收集一个已经发送完成的描述符中的时间戳。
+ */
+static void
+ethernetif_ptp_tx_collect(uint32_t idx)
+{
+  ETH_DMADescTypeDef *dmatxdesc = &DMATxDscrTab[idx];
+  ETH_PtpTimeTypeDef ts;
+
+  if ((dmatxdesc->Status & ETH_DMATXDESC_TTSS) != (uint32_t)RESET)
+  {
+    ts.Seconds = dmatxdesc->TimeStampHigh;
+    ts.NanoSeconds = dmatxdesc->TimeStampLow;
+    ethernetif_ptp_record(PtpTxTbl, &PtpTxIdx, PtpTxPbuf[idx], &ts);
+  }
+  PtpTxPbuf[idx] = NULL;
+}
+
+/**
+ * 记录帧的最后一个描述符对应的pbuf，在描述符交给DMA之前调用。
+ * 描述符上一帧的时间戳如果还没有收集，先收集。需要持有LOCK_TCPIP_CORE。
+ */
+static void
+ethernetif_ptp_tx_track(ETH_DMADescTypeDef *dmatxdesc, struct pbuf *p)
+{
+  uint32_t idx = dmatxdesc - DMATxDscrTab;
+
+  if (PtpTxPbuf[idx] != NULL)
+  {
+    ethernetif_ptp_tx_collect(idx);
+  }
+  PtpTxPbuf[idx] = p;
+}
+
+/**
+ * 收集所有已经发送完成的帧的时间戳，需要持有LOCK_TCPIP_CORE。
+ */
+static void
+ethernetif_ptp_tx_harvest(void)
+{
+  uint32_t i;
+
+  for (i = 0; i < TxDescCnt; i++)
+  {
+    if ((PtpTxPbuf[i] != NULL) && ((DMATxDscrTab[i].Status & ETH_DMATXDESC_OWN) == (uint32_t)RESET))
+    {
+      ethernetif_ptp_tx_collect(i);
+    }
+  }
+}
+#endif /* ETHIF_PTP */
+
+#if ETHIF_RX_ZERO_COPY
+/**
+ * 给已经交出缓冲区的描述符换上RX_POOL中的空闲缓冲区，并把描述符归还DMA。
+ * 调用者需要持有SYS_ARCH_PROTECT。
+ */
+static void
+ethernetif_rx_refill(void)
+{
+  ETH_RxBufTypeDef *buf;
+  ETH_DMADescTypeDef *dmarxdesc;
+
+  while (RxEmptyCnt > 0)
+  {
+    buf = (ETH_RxBufTypeDef *)LWIP_MEMPOOL_ALLOC(RX_POOL);
+    if (buf == NULL)
+    {
+      /* 没有空闲缓冲区，等协议栈释放pbuf时再补充 */
+      break;
+    }
+    dmarxdesc = &DMARxDscrTab[RxRefillIdx];
+    dmarxdesc->Buffer1Addr = (uint32_t)buf->buff;
+    __DMB();
+    dmarxdesc->Status = ETH_DMARXDESC_OWN;
+
+    RxRefillIdx = (RxRefillIdx + 1) % RxDescCnt;
+    RxEmptyCnt--;
+  }
+
+  /* When Rx Buffer unavailable flag is set: clear it and resume reception */
+  if ((heth.Instance->DMASR & ETH_DMASR_RBUS) != (uint32_t)RESET)
+  {
+    ETH_RingStats.RxBufUnavail++;
+    /* MFC为没有可用描述符时MAC丢弃的帧数，读后清零 */
+    ETH_RingStats.RxMissed += heth.Instance->DMAMFBOCR & ETH_DMAMFBOCR_MFC;
+    heth.Instance->DMASR = ETH_DMASR_RBUS;
+    heth.Instance->DMARPDR = 0;
+  }
+}
+
+/**
+ * pbuf_custom的释放回调，协议栈释放零拷贝接收的pbuf时调用，可能在任意任务中执行。
+ * 缓冲区回到RX_POOL，如果有描述符在等待缓冲区则顺便补上。
+ *
+ * @param p 由low_level_input()分配的pbuf
+ */
+static void
+ethernetif_rx_pbuf_free(struct pbuf *p)
+{
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  SYS_ARCH_PROTECT(old_level);
+  LWIP_MEMPOOL_FREE(RX_POOL, p);
+  ethernetif_rx_refill();
+  SYS_ARCH_UNPROTECT(old_level);
+}
+
+/**
+ * 初始化接收描述符链表(链式结构)，每个描述符从RX_POOL中取一个缓冲区。
+ * 代替HAL_ETH_DMARxDescListInit()，后者要求所有缓冲区连续存放。
+ */
+static void
+ethernetif_rx_desc_init(void)
+{
+  uint32_t i;
+  ETH_DMADescTypeDef *dmarxdesc;
+  ETH_RxBufTypeDef *buf;
+
+  LWIP_MEMPOOL_INIT(RX_POOL);
+
+  heth.RxDesc = DMARxDscrTab;
+  for (i = 0; i < RxDescCnt; i++)
+  {
+    dmarxdesc = &DMARxDscrTab[i];
+    buf = (ETH_RxBufTypeDef *)LWIP_MEMPOOL_ALLOC(RX_POOL);
+    LWIP_ASSERT("ETHIF_RX_BUF_CNT must be >= RX ring size", buf != NULL);
+
+    dmarxdesc->ControlBufferSize = ETH_DMARXDESC_RCH | ETH_RX_BUF_SIZE;
+    dmarxdesc->Buffer1Addr = (uint32_t)buf->buff;
+    dmarxdesc->Buffer2NextDescAddr = (uint32_t)&DMARxDscrTab[(i + 1) % RxDescCnt];
+    dmarxdesc->Status = ETH_DMARXDESC_OWN;
+  }
+  RxRefillIdx = 0;
+  RxEmptyCnt = 0;
+
+  /* Set Receive Descriptor List Address Register */
+  heth.Instance->DMARDLAR = (uint32_t)DMARxDscrTab;
+}
+#endif /* ETHIF_RX_ZERO_COPY */
+
+#if ETHIF_MCAST_FILTER
+/**
+ * 计算组播MAC地址在哈希表中的位置：CRC32取反后按位反转，高6位为位号
+ */
+static uint32_t
+ethernetif_mcast_hash(const uint8_t *addr)
+{
+  uint32_t crc = 0xFFFFFFFFU;
+  uint32_t i, j;
+
+  for (i = 0; i < ETH_HWADDR_LEN; i++) {
+    crc ^= addr[i];
+    for (j = 0; j < 8; j++) {
+      crc = (crc >> 1) ^ ((crc & 1U) ? 0xEDB88320U : 0U);
+    }
+  }
+
+  return __RBIT(~crc) >> 26;
+}
+
+/**
+ * 增加或减少一个组播MAC地址的引用，位号的引用计数在0和1之间变化时才改写MACHTHR/MACHTLR
+ */
+static err_t
+ethernetif_mcast_update(const uint8_t *addr, enum netif_mac_filter_action action)
+{
+  uint32_t bit = ethernetif_mcast_hash(addr);
+  uint32_t mask = 1U << (bit & 31U);
+  __IO uint32_t *reg = (bit & 32U) ? &heth.Instance->MACHTHR : &heth.Instance->MACHTLR;
+
+  if (action == NETIF_ADD_MAC_FILTER) {
+    if (McastHashRef[bit] == 0xFFU) {
+      return ERR_MEM;
+    }
+    if (McastHashRef[bit]++ == 0) {
+      *reg |= mask;
+    }
+  } else {
+    if (McastHashRef[bit] == 0) {
+      return ERR_VAL;
+    }
+    if (--McastHashRef[bit] == 0) {
+      *reg &= ~mask;
+    }
+  }
+
+  return ERR_OK;
+}
+
+/**
+ * 打开MAC的组播哈希过滤，哈希表清空，只有加入的组才能通过
+ */
+static void
+ethernetif_mcast_init(void)
+{
+  uint32_t tmpreg;
+
+  memset(McastHashRef, 0, sizeof(McastHashRef));
+  heth.Instance->MACHTHR = 0;
+  heth.Instance->MACHTLR = 0;
+
+  tmpreg = heth.Instance->MACFFR;
+  tmpreg &= ~(ETH_MACFFR_PAM | ETH_MACFFR_HPF);
+  tmpreg |= ETH_MACFFR_HM;
+  heth.Instance->MACFFR = tmpreg;
+
+  /* Wait until the write operation will be taken into account:
+     at least four TX_CLK/RX_CLK clock cycles */
+  tmpreg = heth.Instance->MACFFR;
+  HAL_Delay(ETH_REG_WRITE_DELAY);
+  heth.Instance->MACFFR = tmpreg;
+}
+
+#if LWIP_IGMP
+/**
+ * igmp_mac_filter回调，IPv4组播地址映射为01:00:5e加组地址的低23位
+ */
+static err_t
+ethernetif_igmp_mac_filter(struct netif *netif, const ip4_addr_t *group,
+                           enum netif_mac_filter_action action)
+{
+  uint8_t mac[ETH_HWADDR_LEN];
+  uint32_t addr = lwip_ntohl(ip4_addr_get_u32(group));
+
+  LWIP_UNUSED_ARG(netif);
+
+  mac[0] = 0x01;
+  mac[1] = 0x00;
+  mac[2] = 0x5e;
+  mac[3] = (uint8_t)((addr >> 16) & 0x7F);
+  mac[4] = (uint8_t)(addr >> 8);
+  mac[5] = (uint8_t)addr;
+
+  return ethernetif_mcast_update(mac, action);
+}
+#endif /* LWIP_IGMP */
+
+#if LWIP_IPV6 && LWIP_IPV6_MLD
+/**
+ * mld_mac_filter回调，IPv6组播地址映射为33:33加组地址的低32位
+ */
+static err_t
+ethernetif_mld_mac_filter(struct netif *netif, const ip6_addr_t *group,
+                          enum netif_mac_filter_action action)
+{
+  uint8_t mac[ETH_HWADDR_LEN];
+  uint32_t addr = lwip_ntohl(group->addr[3]);
+
+  LWIP_UNUSED_ARG(netif);
+
+  mac[0] = 0x33;
+  mac[1] = 0x33;
+  mac[2] = (uint8_t)(addr >> 24);
+  mac[3] = (uint8_t)(addr >> 16);
+  mac[4] = (uint8_t)(addr >> 8);
+  mac[5] = (uint8_t)addr;
+
+  return ethernetif_mcast_update(mac, action);
+}
+#endif /* LWIP_IPV6 && LWIP_IPV6_MLD */
+#endif /* ETHIF_MCAST_FILTER */
+
+#if ETHIF_TX_CPLT_IT
+/**
+  * @brief  Ethernet Tx Transfer completed callback
+  *         帧的最后一个描述符设置了IC位，发送完成后唤醒以太网任务回收pbuf、发送排队的帧
+  * @param  heth: ETH handle
+  * @retval None
+  */
+void HAL_ETH_TxCpltCallback(ETH_HandleTypeDef *heth)
+{
+  OS_ERR err;
+
+  OSSemPost(&ETH_SemRx,
+            OS_OPT_POST_1,
+            &err);
+}
+#endif /* ETHIF_TX_CPLT_IT */
+
+#if ETHIF_TX_ZERO_COPY
+/**
+ * 回收DMA已经发送完成的描述符，释放零拷贝发送时持有的pbuf。
+ * 需要持有LOCK_TCPIP_CORE，在low_level_output()和以太网任务中调用。
+ */
+static void
+ethernetif_tx_reclaim(void)
+{
+  ETH_DMADescTypeDef *dmatxdesc;
+  struct pbuf_batch batch;
+
+  /* 一次回收的帧一起释放，只进一次内存池的临界区 */
+  pbuf_batch_init(&batch);
+  while (TxBusyCnt > 0)
+  {
+    dmatxdesc = &DMATxDscrTab[TxReclaimIdx];
+    if ((dmatxdesc->Status & ETH_DMATXDESC_OWN) != (uint32_t)RESET)
+    {
+      break;
+    }
+    if (TxPbuf[TxReclaimIdx] != NULL)
+    {
+      pbuf_free_deferred(&batch, TxPbuf[TxReclaimIdx]);
+      TxPbuf[TxReclaimIdx] = NULL;
+    }
+    TxReclaimIdx = (TxReclaimIdx + 1) % TxDescCnt;
+    TxBusyCnt--;
+  }
+  pbuf_batch_flush(&batch);
+}
+
+/**
+ * 零拷贝发送：pbuf链的每一段直接对应一个发送描述符(FS/LS标记帧的首尾)，
+ * 持有pbuf的引用直到DMA清除OWN位。
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param p the MAC packet to send
+ * @return ERR_OK 已经交给DMA
+ *         ERR_BUF 有数据段DMA无法访问/数据可能被修改/描述符不够，需要走拷贝发送
+ */
+static err_t
+low_level_output_sg(struct netif *netif, struct pbuf *p)
+{
+  struct pbuf *q;
+  ETH_DMADescTypeDef *first = heth.TxDesc;
+  ETH_DMADescTypeDef *dmatxdesc = heth.TxDesc;
+  uint32_t segcount = 0;
+  uint32_t i = 0;
+  uint32_t status;
+  uint32_t cic = ethernetif_tx_cic(netif);
+
+  for (q = p; q != NULL; q = q->next)
+  {
+    if (q->len == 0)
+    {
+      continue;
+    }
+    if (!ETH_DMA_REACHABLE(q->payload) || PBUF_NEEDS_COPY(q))
+    {
+      return ERR_BUF;
+    }
+    segcount++;
+  }
+  if ((segcount == 0) || (segcount > (TxDescCnt - TxBusyCnt)))
+  {
+    return ERR_BUF;
+  }
+
+  pbuf_ref(p);
+  for (q = p; q != NULL; q = q->next)
+  {
+    if (q->len == 0)
+    {
+      continue;
+    }
+    dmatxdesc->Buffer1Addr = (uint32_t)q->payload;
+    dmatxdesc->ControlBufferSize = (q->len & ETH_DMATXDESC_TBS1);
+
+    status = ETH_DMATXDESC_TCH | cic;
+    if (i == 0)
+    {
+      status |= ETH_DMATXDESC_FS;
+#if ETHIF_PTP
+      status |= ETH_DMATXDESC_TTSE;
+#endif
+    }
+    else
+    {
+      /* 第一个描述符最后再交给DMA，避免DMA发送不完整的帧 */
+      status |= ETH_DMATXDESC_OWN;
+    }
+    if (i == (segcount - 1))
+    {
+      status |= ETH_DMATXDESC_LS | ETH_DMATXDESC_IC;
+      TxPbuf[dmatxdesc - DMATxDscrTab] = p;
+#if ETHIF_PTP
+      ethernetif_ptp_tx_track(dmatxdesc, p);
+#endif
+    }
+    dmatxdesc->Status = status;
+
+    dmatxdesc = (ETH_DMADescTypeDef *)(dmatxdesc->Buffer2NextDescAddr);
+    i++;
+  }
+  __DMB();
+  first->Status |= ETH_DMATXDESC_OWN;
+
+  heth.TxDesc = dmatxdesc;
+  TxBusyCnt += segcount;
+  ethernetif_tx_hiwater();
+
+  /* When Tx Buffer unavailable flag is set: clear it and resume transmission */
+  if ((heth.Instance->DMASR & ETH_DMASR_TBUS) != (uint32_t)RESET)
+  {
+    heth.Instance->DMASR = ETH_DMASR_TBUS;
+    heth.Instance->DMATPDR = 0;
+  }
+  return ERR_OK;
+}
+#endif /* ETHIF_TX_ZERO_COPY */
+
 /**
  * In this function, the hardware should be initialized.
  * Called from ethernetif_init().
@@ -157,19 +913,43 @@ low_level_init(struct netif *netif)
   heth.Init.MACAddr[4] = NETIF0_MAC_ADDRESS4;
   heth.Init.MACAddr[5] = NETIF0_MAC_ADDRESS5;
   heth.Init.RxMode = ETH_RXINTERRUPT_MODE;
+#if CHECKSUM_BY_HARDWARE
+  heth.Init.ChecksumMode = ETH_CHECKSUM_BY_HARDWARE;
+#else
   heth.Init.ChecksumMode = ETH_CHECKSUM_BY_SOFTWARE;
+#endif
   heth.Init.MediaInterface = ETH_MEDIA_INTERFACE_RMII;
 
   if (HAL_ETH_Init(&heth) == HAL_OK)
   {
     netif->flags |= NETIF_FLAG_LINK_UP;
   }
+#if ETHIF_PTP
+  ethernetif_ptp_init();
+#endif
+#if ETHIF_MCAST_FILTER
+  ethernetif_mcast_init();
+#endif
+
+  ETH_RingStats.RxDescCnt = RxDescCnt;
+  ETH_RingStats.TxDescCnt = TxDescCnt;
 
   /* Initialize Tx Descriptors list: Chain Mode */
-  HAL_ETH_DMATxDescListInit(&heth, DMATxDscrTab, &Tx_Buff[0][0], ETH_TXBUFNB);
+  HAL_ETH_DMATxDescListInit(&heth, DMATxDscrTab, &Tx_Buff[0][0], TxDescCnt);
+#if ETHIF_TX_CPLT_IT
+  /* HAL默认只打开接收中断，回收零拷贝发送的pbuf和发送排队的帧需要发送完成中断 */
+  __HAL_ETH_DMA_ENABLE_IT(&heth, ETH_DMA_IT_T);
+#endif
      
   /* Initialize Rx Descriptors list: Chain Mode  */
-  HAL_ETH_DMARxDescListInit(&heth, DMARxDscrTab, &Rx_Buff[0][0], ETH_RXBUFNB);
+#if ETHIF_RX_ZERO_COPY
+  ethernetif_rx_desc_init();
+#else
+  HAL_ETH_DMARxDescListInit(&heth, DMARxDscrTab, &Rx_Buff[0][0], RxDescCnt);
+#endif
+#if ETHIF_RX_COALESCE
+  ethernetif_rx_coalesce_apply();
+#endif
 
   // struct ethernetif *ethernetif = netif->state;
 
@@ -195,6 +975,22 @@ low_level_init(struct netif *netif)
 #else
   netif->flags |= NETIF_FLAG_BROADCAST;
 #endif  /* LWIP_ARP */
+#if LWIP_IGMP
+  netif->flags |= NETIF_FLAG_IGMP;
+#endif
+#if LWIP_IPV6 && LWIP_IPV6_MLD
+  netif->flags |= NETIF_FLAG_MLD6;
+#endif
+
+#if CHECKSUM_BY_HARDWARE
+  /* IP首部和TCP校验和由MAC生成，IP首部由MAC检查。TCP/UDP/ICMP只有MAC验证过的帧(PBUF_FLAG_RX_HWCHKSUM)
+     跳过软件检查，MAC不检查的IP分片重组之后仍由协议栈检查。
+     MAC不给IP分片插入校验和，UDP数据报和ICMP回显应答(大ping)超过MTU时会被分片，所以仍由协议栈生成；
+     TCP按MSS分段，不会分片 */
+  NETIF_SET_CHECKSUM_CTRL(netif, NETIF_CHECKSUM_GEN_UDP | NETIF_CHECKSUM_GEN_ICMP | NETIF_CHECKSUM_GEN_ICMP6 |
+                                 NETIF_CHECKSUM_CHECK_UDP | NETIF_CHECKSUM_CHECK_TCP |
+                                 NETIF_CHECKSUM_CHECK_ICMP | NETIF_CHECKSUM_CHECK_ICMP6);
+#endif
 
   /* 创建一个用于通知接收数据包的二值信号量 */
   OSSemCreate(&ETH_SemRx,
@@ -223,6 +1019,23 @@ low_level_init(struct netif *netif)
                */
                (OS_ERR        *)&err);
 
+#if ETHIF_LINK_MONITOR
+  /* 创建一个任务用于监测PHY的连接状态 */
+  OSTaskCreate((OS_TCB        *)&ETH_LinkTaskTCB,
+               (CPU_CHAR      *)"ethlink_thread",
+               (OS_TASK_PTR    )ethernetif_link_thread,
+               (void          *)netif,
+               (OS_PRIO        )ETH_LINK_TASK_PRIO,
+               (CPU_STK       *)ETH_LinkTaskSTK,
+               (CPU_STK_SIZE   )ETH_LINK_TASK_STACK_SIZE / 10,
+               (CPU_STK_SIZE   )ETH_LINK_TASK_STACK_SIZE,
+               (OS_MSG_QTY     )0,
+               (OS_TICK        )0,
+               (void          *)0,
+               (OS_OPT         )(OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),
+               (OS_ERR        *)&err);
+#endif
+
 #if LWIP_IPV6 && LWIP_IPV6_MLD
   /*
    * For hardware/netifs that implement MAC filtering.
@@ -269,70 +1082,361 @@ low_level_output(struct netif *netif, struct pbuf *p)
   uint32_t bufferoffset = 0;
   uint32_t byteslefttocopy = 0;
   uint32_t payloadoffset = 0;
+#if ETHIF_TX_ZERO_COPY
+  ETH_DMADescTypeDef *firstdesc;
+  int32_t usedcount;
+
+  ethernetif_tx_reclaim();
+  if (low_level_output_sg(netif, p) == ERR_OK)
+  {
+    return ERR_OK;
+  }
+
+  /* 描述符可能还指向上一次零拷贝发送的pbuf，拷贝发送前先指回Tx_Buff */
+  firstdesc = heth.TxDesc;
+  if ((firstdesc->Status & ETH_DMATXDESC_OWN) == (uint32_t)RESET)
+  {
+    firstdesc->Buffer1Addr = (uint32_t)Tx_Buff[firstdesc - DMATxDscrTab];
+  }
+  buffer = (uint8_t *)(firstdesc->Buffer1Addr);
+#endif
   DmaTxDesc = heth.TxDesc;
   bufferoffset = 0;
   
   /* copy frame from pbufs to driver buffers */
   for(q = p; q != NULL; q = q->next)
   {
-    /* Is this buffer available? If not, goto error */
-    if((DmaTxDesc->Status & ETH_DMATXDESC_OWN) != (uint32_t)RESET)
-    {
-      errval = ERR_USE;
-      goto error;
-    }
-  
-    /* Get bytes in current lwIP buffer */
-    byteslefttocopy = q->len;
-    payloadoffset = 0;
-  
-    /* Check if the length of data to copy is bigger than Tx buffer size*/
-    while( (byteslefttocopy + bufferoffset) > ETH_TX_BUF_SIZE )
+    /* Is this buffer available? If not, goto error */
+    if((DmaTxDesc->Status & ETH_DMATXDESC_OWN) != (uint32_t)RESET)
+    {
+      errval = ERR_USE;
+      goto error;
+    }
+  
+    /* Get bytes in current lwIP buffer */
+    byteslefttocopy = q->len;
+    payloadoffset = 0;
+  
+    /* Check if the length of data to copy is bigger than Tx buffer size*/
+    while( (byteslefttocopy + bufferoffset) > ETH_TX_BUF_SIZE )
+    {
+      /* Copy data to Tx buffer*/
+      memcpy( (uint8_t*)((uint8_t*)buffer + bufferoffset), (uint8_t*)((uint8_t*)q->payload + payloadoffset), (ETH_TX_BUF_SIZE - bufferoffset) );
+    
+      /* Point to next descriptor */
+      DmaTxDesc = (ETH_DMADescTypeDef *)(DmaTxDesc->Buffer2NextDescAddr);
+    
+      /* Check if the buffer is available */
+      if((DmaTxDesc->Status & ETH_DMATXDESC_OWN) != (uint32_t)RESET)
+      {
+        errval = ERR_USE;
+        goto error;
+      }
+    
+#if ETHIF_TX_ZERO_COPY
+      DmaTxDesc->Buffer1Addr = (uint32_t)Tx_Buff[DmaTxDesc - DMATxDscrTab];
+#endif
+      buffer = (uint8_t *)(DmaTxDesc->Buffer1Addr);
+    
+      byteslefttocopy = byteslefttocopy - (ETH_TX_BUF_SIZE - bufferoffset);
+      payloadoffset = payloadoffset + (ETH_TX_BUF_SIZE - bufferoffset);
+      framelength = framelength + (ETH_TX_BUF_SIZE - bufferoffset);
+      bufferoffset = 0;
+    }
+  
+    /* Copy the remaining bytes */
+    memcpy( (uint8_t*)((uint8_t*)buffer + bufferoffset), (uint8_t*)((uint8_t*)q->payload + payloadoffset), byteslefttocopy );
+    bufferoffset = bufferoffset + byteslefttocopy;
+    framelength = framelength + byteslefttocopy;
+  }
+
+  /* 每帧设置校验和插入方式，CIC位只在帧的第一个描述符中有效 */
+  heth.TxDesc->Status = (heth.TxDesc->Status & ~ETH_DMATXDESC_CIC) | ethernetif_tx_cic(netif);
+#if (ETHIF_TX_QUEUE_LEN > 0) || ETHIF_PTP
+  /* 帧不超过ETH_TX_BUF_SIZE，只占一个描述符；发送完成中断用来发送排队的帧、收集时间戳 */
+  heth.TxDesc->Status |= ETH_DMATXDESC_IC;
+#endif
+#if ETHIF_PTP
+  ethernetif_ptp_tx_track(heth.TxDesc, p);
+  heth.TxDesc->Status |= ETH_DMATXDESC_TTSE;
+#endif
+
+  /* Prepare transmit descriptors to give to DMA */ 
+  HAL_ETH_TransmitFrame(&heth, framelength);
+  ethernetif_tx_hiwater();
+#if ETHIF_TX_ZERO_COPY
+  /* 拷贝发送占用的描述符同样计入TxBusyCnt，回收时按顺序跳过 */
+  usedcount = (int32_t)(heth.TxDesc - firstdesc);
+  if (usedcount < 0)
+  {
+    usedcount += TxDescCnt;
+  }
+  TxBusyCnt += (uint32_t)usedcount;
+#endif
+  
+  errval = ERR_OK;
+  
+error:
+  
+  if (errval == ERR_USE)
+  {
+    ETH_RingStats.TxBusy++;
+  }
+
+  /* When Transmit Underflow flag is set, clear it and issue a Transmit Poll Demand to resume transmission */
+  if ((heth.Instance->DMASR & ETH_DMASR_TUS) != (uint32_t)RESET)
+  {
+    ETH_RingStats.TxUnderflow++;
+    /* Clear TUS ETHERNET DMA flag */
+    heth.Instance->DMASR = ETH_DMASR_TUS;
+
+    /* Resume DMA transmission*/
+    heth.Instance->DMATPDR = 0;
+  }
+  return errval;
+}
+
+#if ETHIF_TX_QUEUE_LEN > 0
+/**
+ * 按顺序发送队列中暂存的帧，直到队列为空或者描述符又被DMA占满。
+ * 需要持有LOCK_TCPIP_CORE。
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ */
+static void
+ethernetif_tx_drain(struct netif *netif)
+{
+  struct pbuf *p;
+  struct pbuf_batch batch;
+
+  pbuf_batch_init(&batch);
+  while (TxQueueCnt > 0)
+  {
+    p = TxQueue[TxQueueHead];
+    if (low_level_output(netif, p) == ERR_USE)
+    {
+      break;
+    }
+    TxQueue[TxQueueHead] = NULL;
+    TxQueueHead = (TxQueueHead + 1) % ETHIF_TX_QUEUE_LEN;
+    TxQueueCnt--;
+    pbuf_free_deferred(&batch, p);
+  }
+  pbuf_batch_flush(&batch);
+}
+
+/**
+ * 排队版本的netif->linkoutput：描述符被DMA占用时把帧放进发送队列，不再返回ERR_USE丢帧。
+ * 队列不为空时新帧也要排在后面，保证发送顺序。
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param p the MAC packet to send
+ * @return ERR_OK 已经交给DMA或者已经排队
+ *         ERR_MEM 队列已满或者复制pbuf失败，帧被丢弃
+ */
+static err_t
+low_level_output_queued(struct netif *netif, struct pbuf *p)
+{
+  err_t errval;
+  struct pbuf *q;
+
+  ethernetif_tx_drain(netif);
+  if (TxQueueCnt == 0)
+  {
+    errval = low_level_output(netif, p);
+    if (errval != ERR_USE)
+    {
+      return errval;
+    }
+  }
+
+  if (TxQueueCnt >= ETHIF_TX_QUEUE_LEN)
+  {
+    ETH_RingStats.TxQueueDrop++;
+    return ERR_MEM;
+  }
+  /* 与etharp的待发送队列相同：链中任何一段的数据可能被调用者修改时(例如UDP头后面接着
+     netbuf_ref的PBUF_REF数据)复制整条链，否则只增加引用 */
+  for (q = p; q != NULL; q = q->next)
+  {
+    if (PBUF_NEEDS_COPY(q))
+    {
+      break;
+    }
+  }
+  if (q != NULL)
+  {
+    q = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+    if (q == NULL)
+    {
+      ETH_RingStats.TxQueueDrop++;
+      return ERR_MEM;
+    }
+  }
+  else
+  {
+    q = p;
+    pbuf_ref(q);
+  }
+  TxQueue[(TxQueueHead + TxQueueCnt) % ETHIF_TX_QUEUE_LEN] = q;
+  TxQueueCnt++;
+  if (TxQueueCnt > ETH_RingStats.TxQueueHighWater)
+  {
+    ETH_RingStats.TxQueueHighWater = TxQueueCnt;
+  }
+  return ERR_OK;
+}
+#endif /* ETHIF_TX_QUEUE_LEN > 0 */
+
+#if ETHIF_TX_CPLT_IT
+/**
+ * 发送完成后的处理：收集发送时间戳，回收零拷贝发送持有的pbuf，发送队列中暂存的帧。
+ * 需要持有LOCK_TCPIP_CORE，在以太网任务中调用。
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ */
+static void
+ethernetif_tx_cplt(struct netif *netif)
+{
+  LWIP_UNUSED_ARG(netif);
+#if ETHIF_PTP
+  ethernetif_ptp_tx_harvest();
+#endif
+#if ETHIF_TX_ZERO_COPY
+  ethernetif_tx_reclaim();
+#endif
+#if ETHIF_TX_QUEUE_LEN > 0
+  ethernetif_tx_drain(netif);
+#endif
+}
+#endif /* ETHIF_TX_CPLT_IT */
+
+#if ETHIF_RX_ZERO_COPY
+/**
+ * 零拷贝版本：不分配PBUF_POOL也不拷贝数据，把帧所在的DMA缓冲区包装成
+ * pbuf_custom交给协议栈，描述符随即换上新的缓冲区归还DMA。
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @return a pbuf filled with the received packet (including MAC header)
+ *         NULL on memory error
+ */
+static struct pbuf *
+low_level_input(struct netif *netif)
+{
+  struct pbuf *p = NULL;
+  struct pbuf *q = NULL;
+  ETH_RxBufTypeDef *buf;
+  ETH_DMADescTypeDef *dmarxdesc;
+  uint32_t len = 0;
+  uint32_t seglen = 0;
+  uint32_t i = 0;
+  int chkerr = 0;
+  int chkok = 0;
+#if ETHIF_PTP
+  ETH_PtpTimeTypeDef ts;
+  int tsvalid;
+#endif
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  /* 所有描述符都在等缓冲区，此时OWN位为0的描述符里是已经交出去的旧帧 */
+  if (RxEmptyCnt >= RxDescCnt)
+    return NULL;
+
+  ethernetif_rx_hiwater();
+
+  /* get received frame */
+  if (HAL_ETH_GetReceivedFrame_IT(&heth) != HAL_OK)
+    return NULL;
+  ETH_RingStats.RxFrames++;
+
+  len = heth.RxFrameInfos.length;
+  dmarxdesc = heth.RxFrameInfos.FSRxDesc;
+#if ETHIF_PTP
+  /* 描述符换上新缓冲区之后DMA可能覆盖时间戳，先取出来 */
+  tsvalid = ethernetif_ptp_rx_stamp(&ts);
+#endif
+#if CHECKSUM_BY_HARDWARE
+  /* 描述符换上新缓冲区之后DMA可能覆盖扩展状态，先取出校验结果 */
+  chkerr = ethernetif_rx_chkerr();
+  if (chkerr)
+  {
+    LINK_STATS_INC(link.chkerr);
+    LINK_STATS_INC(link.drop);
+  }
+  chkok = ethernetif_rx_chkok();
+#endif
+
+  SYS_ARCH_PROTECT(old_level);
+  for (i = 0; i < heth.RxFrameInfos.SegCount; i++)
+  {
+    buf = (ETH_RxBufTypeDef *)(dmarxdesc->Buffer1Addr - offsetof(ETH_RxBufTypeDef, buff));
+    if ((len > 0) && !chkerr)
     {
-      /* Copy data to Tx buffer*/
-      memcpy( (uint8_t*)((uint8_t*)buffer + bufferoffset), (uint8_t*)((uint8_t*)q->payload + payloadoffset), (ETH_TX_BUF_SIZE - bufferoffset) );
-    
-      /* Point to next descriptor */
-      DmaTxDesc = (ETH_DMADescTypeDef *)(DmaTxDesc->Buffer2NextDescAddr);
-    
-      /* Check if the buffer is available */
-      if((DmaTxDesc->Status & ETH_DMATXDESC_OWN) != (uint32_t)RESET)
+      /* 每个段对应一个pbuf_custom，多段的帧组成pbuf链 */
+      seglen = LWIP_MIN(len, ETH_RX_BUF_SIZE);
+      buf->pc.custom_free_function = ethernetif_rx_pbuf_free;
+      q = pbuf_alloced_custom(PBUF_RAW, (u16_t)seglen, PBUF_REF, &buf->pc,
+                              buf->buff, ETH_RX_BUF_SIZE);
+      if (p == NULL)
       {
-        errval = ERR_USE;
-        goto error;
+        p = q;
       }
-    
-      buffer = (uint8_t *)(DmaTxDesc->Buffer1Addr);
-    
-      byteslefttocopy = byteslefttocopy - (ETH_TX_BUF_SIZE - bufferoffset);
-      payloadoffset = payloadoffset + (ETH_TX_BUF_SIZE - bufferoffset);
-      framelength = framelength + (ETH_TX_BUF_SIZE - bufferoffset);
-      bufferoffset = 0;
+      else
+      {
+        pbuf_cat(p, q);
+      }
+      len -= seglen;
     }
-  
-    /* Copy the remaining bytes */
-    memcpy( (uint8_t*)((uint8_t*)buffer + bufferoffset), (uint8_t*)((uint8_t*)q->payload + payloadoffset), byteslefttocopy );
-    bufferoffset = bufferoffset + byteslefttocopy;
-    framelength = framelength + byteslefttocopy;
+    else
+    {
+      /* 空帧和校验错误的帧不交给协议栈，缓冲区直接放回RX_POOL */
+      LWIP_MEMPOOL_FREE(RX_POOL, buf);
+    }
+    /* 描述符的缓冲区已经交出，等待补充新缓冲区 */
+    RxEmptyCnt++;
+    dmarxdesc = (ETH_DMADescTypeDef *)(dmarxdesc->Buffer2NextDescAddr);
   }
+  ethernetif_rx_refill();
+  SYS_ARCH_UNPROTECT(old_level);
 
-  /* Prepare transmit descriptors to give to DMA */ 
-  HAL_ETH_TransmitFrame(&heth, framelength);
-  
-  errval = ERR_OK;
-  
-error:
-  
-  /* When Transmit Underflow flag is set, clear it and issue a Transmit Poll Demand to resume transmission */
-  if ((heth.Instance->DMASR & ETH_DMASR_TUS) != (uint32_t)RESET)
+  /* Clear Segment_Count */
+  heth.RxFrameInfos.SegCount = 0;
+
+  if (chkok && (p != NULL))
   {
-    /* Clear TUS ETHERNET DMA flag */
-    heth.Instance->DMASR = ETH_DMASR_TUS;
+    p->flags |= PBUF_FLAG_RX_HWCHKSUM;
+  }
+#if ETHIF_PTP
+  if (tsvalid && (p != NULL))
+  {
+    ethernetif_ptp_record(PtpRxTbl, &PtpRxIdx, p, &ts);
+  }
+#endif
+  return p;
+}
+#else
+/**
+ * 把接收缓冲区中的一段数据拷贝到pbuf的offset处。LWIP_CHECKSUM_ON_RX_COPY时拷贝的同时求和，
+ * 按这一段在pbuf中的偏移累加到acc，整个pbuf拷贝完后用pbuf_set_rx_chksum()记录，
+ * TCP/UDP/ICMP校验时不用再读一遍数据
+ */
+static u32_t
+ethernetif_rx_copy(struct pbuf *q, uint32_t offset, const uint8_t *src, uint32_t len, u32_t acc)
+{
+#if LWIP_CHECKSUM_ON_RX_COPY
+  u16_t sum = LWIP_CHKSUM_COPY((uint8_t *)q->payload + offset, src, (u16_t)len);
 
-    /* Resume DMA transmission*/
-    heth.Instance->DMATPDR = 0;
+  /* 奇数偏移处开始的一段，高低字节和pbuf起始处对齐的和相反 */
+  if (offset & 1)
+  {
+    sum = SWAP_BYTES_IN_WORD(sum);
   }
-  return errval;
+  acc += sum;
+  return FOLD_U32T(acc);
+#else
+  memcpy((uint8_t *)q->payload + offset, src, len);
+  return acc;
+#endif
 }
 
 /**
@@ -355,21 +1459,47 @@ low_level_input(struct netif *netif)
   uint32_t payloadoffset = 0;
   uint32_t byteslefttocopy = 0;
   uint32_t i=0;
+  u32_t acc;
+  int chkok = 0;
+#if ETHIF_PTP
+  ETH_PtpTimeTypeDef ts;
+  int tsvalid;
+#endif
   
+  ethernetif_rx_hiwater();
 
   /* get received frame */
   if (HAL_ETH_GetReceivedFrame_IT(&heth) != HAL_OK)
   
     return NULL;
+  ETH_RingStats.RxFrames++;
   
   /* Obtain the size of the packet and put it into the "len" variable. */
   len = heth.RxFrameInfos.length;
   buffer = (uint8_t *)heth.RxFrameInfos.buffer;
+#if ETHIF_PTP
+  tsvalid = ethernetif_ptp_rx_stamp(&ts);
+#endif
+  
+#if CHECKSUM_BY_HARDWARE
+  /* 硬件校验错误的帧直接丢弃，描述符照常归还DMA */
+  if (ethernetif_rx_chkerr())
+  {
+    LINK_STATS_INC(link.chkerr);
+    LINK_STATS_INC(link.drop);
+    len = 0;
+  }
+  chkok = ethernetif_rx_chkok();
+#endif
   
   if (len > 0)
   {
     /* We allocate a pbuf chain of pbufs from the Lwip buffer pool */
     p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+    if (p == NULL)
+    {
+      ETH_RingStats.RxNoPbuf++;
+    }
   }
   
   if (p != NULL)
@@ -380,12 +1510,13 @@ low_level_input(struct netif *netif)
     {
       byteslefttocopy = q->len;
       payloadoffset = 0;
+      acc = 0;
       
       /* Check if the length of bytes to copy in current pbuf is bigger than Rx buffer size*/
       while( (byteslefttocopy + bufferoffset) > ETH_RX_BUF_SIZE )
       {
         /* Copy data to pbuf */
-        memcpy( (uint8_t*)((uint8_t*)q->payload + payloadoffset), (uint8_t*)((uint8_t*)buffer + bufferoffset), (ETH_RX_BUF_SIZE - bufferoffset));
+        acc = ethernetif_rx_copy(q, payloadoffset, buffer + bufferoffset, ETH_RX_BUF_SIZE - bufferoffset, acc);
         
         /* Point to next descriptor */
         dmarxdesc = (ETH_DMADescTypeDef *)(dmarxdesc->Buffer2NextDescAddr);
@@ -396,8 +1527,15 @@ low_level_input(struct netif *netif)
         bufferoffset = 0;
       }
       /* Copy remaining data in pbuf */
-      memcpy( (uint8_t*)((uint8_t*)q->payload + payloadoffset), (uint8_t*)((uint8_t*)buffer + bufferoffset), byteslefttocopy);
+      acc = ethernetif_rx_copy(q, payloadoffset, buffer + bufferoffset, byteslefttocopy, acc);
       bufferoffset = bufferoffset + byteslefttocopy;
+#if LWIP_CHECKSUM_ON_RX_COPY
+      pbuf_set_rx_chksum(q, (u16_t)acc);
+#endif
+    }
+    if (chkok)
+    {
+      p->flags |= PBUF_FLAG_RX_HWCHKSUM;
     }
   }  
   
@@ -413,10 +1551,20 @@ low_level_input(struct netif *netif)
     
     /* Clear Segment_Count */
     heth.RxFrameInfos.SegCount =0;  
+
+#if ETHIF_PTP
+  if (tsvalid && (p != NULL))
+  {
+    ethernetif_ptp_record(PtpRxTbl, &PtpRxIdx, p, &ts);
+  }
+#endif
   
   /* When Rx Buffer unavailable flag is set: clear it and resume reception */
   if ((heth.Instance->DMASR & ETH_DMASR_RBUS) != (uint32_t)RESET)  
   {
+    ETH_RingStats.RxBufUnavail++;
+    /* MFC为没有可用描述符时MAC丢弃的帧数，读后清零 */
+    ETH_RingStats.RxMissed += heth.Instance->DMAMFBOCR & ETH_DMAMFBOCR_MFC;
     /* Clear RBUS ETHERNET DMA flag */
     heth.Instance->DMASR = ETH_DMASR_RBUS;
     /* Resume DMA reception */
@@ -424,7 +1572,100 @@ low_level_input(struct netif *netif)
   }
   return p;
 }
+#endif /* ETHIF_RX_ZERO_COPY */
+
+#if ETHIF_RX_BATCH
+/**
+ * 检查接收队列中是否还有DMA已经写好的帧。
+ *
+ * @return 1 heth.RxDesc指向的描述符已经归CPU所有
+ */
+static int
+ethernetif_rx_pending(void)
+{
+#if ETHIF_RX_ZERO_COPY
+  /* 所有描述符都在等缓冲区时OWN位为0的是旧帧，补充缓冲区后DMA收到新帧会再产生中断 */
+  if (RxEmptyCnt >= RxDescCnt)
+  {
+    return 0;
+  }
+#endif
+  return ((heth.RxDesc->Status & ETH_DMARXDESC_OWN) == (uint32_t)RESET);
+}
+
+/**
+ * 批量接收版本：接收中断在HAL_ETH_RxCpltCallback()中关闭，一次加锁最多处理
+ * ETHIF_RX_BUDGET帧。预算用完说明还有帧在排队，延时一个节拍后继续处理；
+ * 接收队列取空后清除RS标志并重新打开接收中断。
+ *
+ * @param p_arg the lwip network interface structure for this ethernetif
+ */
+static void
+ethernetif_input(void *p_arg)
+{
+  OS_ERR err;
+  struct pbuf *p;
+  struct netif *netif = (struct netif *)p_arg;
+  uint32_t count;
+  struct pbuf_batch batch;
+
+  while(1)
+  {
+    OSSemPend(&ETH_SemRx,
+              0,
+              OS_OPT_PEND_BLOCKING,
+              0,
+              &err);
+
+    if(err != OS_ERR_NONE)
+    {
+      continue;
+    }
+
+    while(1)
+    {
+      count = 0;
+      LOCK_TCPIP_CORE();
+#if ETHIF_TX_CPLT_IT
+      /* 发送完成中断也会释放这个信号量，先处理发送完成 */
+      ethernetif_tx_cplt(netif);
+#endif
+      /* 协议栈拒收的帧先收集起来(最多ETHIF_RX_BUDGET帧)，解锁后一起释放 */
+      pbuf_batch_init(&batch);
+      do
+      {
+        p = low_level_input(netif);
+        if(p != NULL)
+        {
+          count++;
+          if(netif->input(p, netif) != ERR_OK)
+          {
+            pbuf_free_deferred(&batch, p);
+          }
+        }
+      }while((p != NULL) && (count < ETHIF_RX_BUDGET));
+      UNLOCK_TCPIP_CORE();
+      pbuf_batch_flush(&batch);
+
+      if(p != NULL)
+      {
+        /* 预算用完，接收中断保持关闭，让出CPU，剩下的帧留在描述符中 */
+        OSTimeDly(1, OS_OPT_TIME_DLY, &err);
+        continue;
+      }
 
+      __HAL_ETH_DMA_CLEAR_IT(&heth, ETH_DMA_IT_R);
+      __HAL_ETH_DMA_ENABLE_IT(&heth, ETH_DMA_IT_R);
+      /* 最后一次取帧到清除RS之间到达的帧不会产生中断，需要再检查一次 */
+      if(!ethernetif_rx_pending())
+      {
+        break;
+      }
+      __HAL_ETH_DMA_DISABLE_IT(&heth, ETH_DMA_IT_R);
+    }
+  }
+}
+#else
 /**
  * This function should be called when a packet is ready to be read
  * from the interface. It uses the function low_level_input() that
@@ -451,6 +1692,12 @@ ethernetif_input(void *p_arg)
 
     if(err == OS_ERR_NONE)
     {
+#if ETHIF_TX_CPLT_IT
+      /* 发送完成中断也会释放这个信号量，先处理发送完成 */
+      LOCK_TCPIP_CORE();
+      ethernetif_tx_cplt(netif);
+      UNLOCK_TCPIP_CORE();
+#endif
       do
       {
         LOCK_TCPIP_CORE();
@@ -467,6 +1714,147 @@ ethernetif_input(void *p_arg)
     }
   }
 }
+#endif /* ETHIF_RX_BATCH */
+
+/**
+ * 设置收发描述符环的深度，需要在netif_add()之前调用。
+ * 描述符和缓冲区在编译时按ETHIF_RX_DESC_MAX/ETHIF_TX_DESC_MAX分配，超出范围时取最接近的值。
+ *
+ * @param rxcnt 接收描述符数量
+ * @param txcnt 发送描述符数量
+ */
+void
+ethernetif_set_ring_size(uint32_t rxcnt, uint32_t txcnt)
+{
+  RxDescCnt = LWIP_MIN(LWIP_MAX(rxcnt, 2), ETHIF_RX_DESC_MAX);
+  TxDescCnt = LWIP_MIN(LWIP_MAX(txcnt, 2), ETHIF_TX_DESC_MAX);
+}
+
+#if ETHIF_RX_COALESCE
+/**
+ * 修改接收中断合并参数，可以在运行时调用。
+ * 中断按描述符在环中的位置产生，frames最好能整除接收描述符数量，并且不超过它的一半，
+ * 否则接收环可能在中断到来之前用完。
+ *
+ * @param frames 每多少帧产生一次接收中断，1表示不合并
+ * @param usec 帧数不足时最多延迟多少微秒产生中断
+ */
+void
+ethernetif_set_rx_coalesce(uint32_t frames, uint32_t usec)
+{
+  RxCoalesceFrames = LWIP_MIN(LWIP_MAX(frames, 1), RxDescCnt);
+  RxCoalesceUsec = usec;
+  ethernetif_rx_coalesce_apply();
+}
+#endif /* ETHIF_RX_COALESCE */
+
+#if ETHIF_PTP
+/**
+ * 读取PTP系统时间。
+ *
+ * @param ts 返回的时间
+ */
+void
+ethernetif_ptp_get_time(ETH_PtpTimeTypeDef *ts)
+{
+  uint32_t sec;
+
+  /* 读纳秒期间秒进位时重读 */
+  do
+  {
+    sec = heth.Instance->PTPTSHR;
+    ts->NanoSeconds = heth.Instance->PTPTSLR;
+  } while (sec != heth.Instance->PTPTSHR);
+  ts->Seconds = sec;
+}
+
+/**
+ * 设置PTP系统时间。
+ *
+ * @param ts 新的时间，NanoSeconds小于1000000000
+ */
+void
+ethernetif_ptp_set_time(const ETH_PtpTimeTypeDef *ts)
+{
+  while ((heth.Instance->PTPTSCR & (ETH_PTPTSCR_TSSTI | ETH_PTPTSCR_TSSTU)) != (uint32_t)RESET)
+  {
+  }
+  heth.Instance->PTPTSHUR = ts->Seconds;
+  heth.Instance->PTPTSLUR = ts->NanoSeconds;
+  heth.Instance->PTPTSCR |= ETH_PTPTSCR_TSSTI;
+}
+
+/**
+ * 按偏移量调整PTP系统时间，由硬件完成加减，不会丢失读改写期间的时间。
+ *
+ * @param offset 偏移量(ns)，负数表示往回调
+ */
+void
+ethernetif_ptp_adjust_time(int64_t offset)
+{
+  uint32_t sign = 0;
+
+  if (offset < 0)
+  {
+    sign = ETH_PTPTSLUR_TSUPNS;
+    offset = -offset;
+  }
+  while ((heth.Instance->PTPTSCR & (ETH_PTPTSCR_TSSTI | ETH_PTPTSCR_TSSTU)) != (uint32_t)RESET)
+  {
+  }
+  heth.Instance->PTPTSHUR = (uint32_t)(offset / 1000000000);
+  heth.Instance->PTPTSLUR = sign | (uint32_t)(offset % 1000000000);
+  heth.Instance->PTPTSCR |= ETH_PTPTSCR_TSSTU;
+}
+
+/**
+ * 调整PTP系统时间的频率，修改加数寄存器。
+ *
+ * @param ppb 相对于标称频率的偏差(十亿分之一)，正数表示加快
+ */
+void
+ethernetif_ptp_adjust_freq(int32_t ppb)
+{
+  uint32_t addend;
+
+  addend = (uint32_t)((int64_t)PtpAddendBase + ((int64_t)PtpAddendBase * ppb) / 1000000000);
+  while ((heth.Instance->PTPTSCR & ETH_PTPTSCR_TSARU) != (uint32_t)RESET)
+  {
+  }
+  heth.Instance->PTPTSAR = addend;
+  heth.Instance->PTPTSCR |= ETH_PTPTSCR_TSARU;
+}
+
+/**
+ * 查询接收帧的硬件时间戳。p为low_level_input()交给协议栈的pbuf，
+ * 例如UDP接收回调中得到的pbuf。
+ *
+ * @param p 接收到的pbuf
+ * @param ts 返回的时间戳
+ * @return ERR_OK 找到时间戳
+ *         ERR_VAL 没有记录，或者记录已经被覆盖
+ */
+err_t
+ethernetif_ptp_get_rx_timestamp(struct pbuf *p, ETH_PtpTimeTypeDef *ts)
+{
+  return ethernetif_ptp_lookup(PtpRxTbl, &PtpRxIdx, p, ts);
+}
+
+/**
+ * 查询发送帧的硬件时间戳。p为交给netif->linkoutput的pbuf，调用者需要持有它的引用
+ * 直到查询结束，否则地址可能被其他pbuf重用。时间戳在发送完成中断之后才能查到。
+ *
+ * @param p 发送的pbuf
+ * @param ts 返回的时间戳
+ * @return ERR_OK 找到时间戳
+ *         ERR_VAL 还没有发送完成，或者记录已经被覆盖
+ */
+err_t
+ethernetif_ptp_get_tx_timestamp(struct pbuf *p, ETH_PtpTimeTypeDef *ts)
+{
+  return ethernetif_ptp_lookup(PtpTxTbl, &PtpTxIdx, p, ts);
+}
+#endif /* ETHIF_PTP */
 
 /**
  * Should be called at the beginning of the program to set up the
@@ -509,7 +1897,17 @@ ethernetif_init(struct netif *netif)
 #if LWIP_IPV6
   netif->output_ip6 = ethip6_output;
 #endif /* LWIP_IPV6 */
+#if ETHIF_TX_QUEUE_LEN > 0
+  netif->linkoutput = low_level_output_queued;
+#else
   netif->linkoutput = low_level_output;
+#endif
+#if LWIP_IGMP
+  netif_set_igmp_mac_filter(netif, ethernetif_igmp_mac_filter);
+#endif
+#if LWIP_IPV6 && LWIP_IPV6_MLD
+  netif_set_mld_mac_filter(netif, ethernetif_mld_mac_filter);
+#endif
 
   /* initialize the hardware */
   low_level_init(netif);
@@ -517,11 +1915,103 @@ ethernetif_init(struct netif *netif)
   return ERR_OK;
 }
 
-void ethernetif_notify_conn_changed(struct netif *netif)
+/**
+ * 按PHY自动协商的结果设置MACCR的速率和双工模式，MAC和DMA保持运行。
+ */
+static void
+ethernetif_mac_update(void)
 {
-  netif->flags &= ~NETIF_FLAG_LINK_UP;
-  if (HAL_ETH_Init(&heth) == HAL_OK)
+  uint32_t tmpreg;
+
+  tmpreg = heth.Instance->MACCR;
+  tmpreg &= ~(ETH_MACCR_FES | ETH_MACCR_DM);
+  tmpreg |= heth.Init.Speed | heth.Init.DuplexMode;
+  heth.Instance->MACCR = tmpreg;
+
+  /* Wait until the write operation will be taken into account:
+     at least four TX_CLK/RX_CLK clock cycles */
+  tmpreg = heth.Instance->MACCR;
+  HAL_Delay(ETH_REG_WRITE_DELAY);
+  heth.Instance->MACCR = tmpreg;
+}
+
+/**
+ * 通过MDIO读取LAN8720A的连接状态，状态变化时更新netif。连接建立后从SCSR读取
+ * 自动协商的结果重新设置MAC，不重新初始化MAC和DMA，描述符环中的数据不受影响。
+ * 需要持有LOCK_TCPIP_CORE。
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ */
+static void
+ethernetif_link_update(struct netif *netif)
+{
+  uint32_t phyreg = 0;
+  int linkup;
+
+  /* BSR的连接状态位断开后锁存为0，第二次读到的才是当前状态 */
+  HAL_ETH_ReadPHYRegister(&heth, PHY_BSR, &phyreg);
+  if (HAL_ETH_ReadPHYRegister(&heth, PHY_BSR, &phyreg) != HAL_OK)
   {
-    netif->flags |= NETIF_FLAG_LINK_UP;
+    return;
+  }
+  linkup = ((phyreg & PHY_LINKED_STATUS) != 0);
+  if ((heth.Init.AutoNegotiation != ETH_AUTONEGOTIATION_DISABLE) && ((phyreg & PHY_AUTONEGO_COMPLETE) == 0))
+  {
+    /* 自动协商还没有完成，下次再检查 */
+    linkup = 0;
+  }
+
+  if (linkup && !netif_is_link_up(netif))
+  {
+    if ((heth.Init.AutoNegotiation != ETH_AUTONEGOTIATION_DISABLE) &&
+        (HAL_ETH_ReadPHYRegister(&heth, PHY_SR, &phyreg) == HAL_OK))
+    {
+      heth.Init.DuplexMode = ((phyreg & PHY_DUPLEX_STATUS) != 0) ? ETH_MODE_FULLDUPLEX : ETH_MODE_HALFDUPLEX;
+      heth.Init.Speed = ((phyreg & PHY_SPEED_STATUS) != 0) ? ETH_SPEED_10M : ETH_SPEED_100M;
+    }
+    ethernetif_mac_update();
+    netif_set_link_up(netif);
+    if (!netif_is_up(netif))
+    {
+      netif_set_up(netif);
+    }
+  }
+  else if (!linkup && netif_is_link_up(netif))
+  {
+    netif_set_link_down(netif);
+  }
+}
+
+#if ETHIF_LINK_MONITOR
+/**
+ * PHY连接状态监测任务，每ETHIF_LINK_POLL_MS毫秒检查一次。
+ *
+ * @param p_arg the lwip network interface structure for this ethernetif
+ */
+static void
+ethernetif_link_thread(void *p_arg)
+{
+  OS_ERR err;
+  struct netif *netif = (struct netif *)p_arg;
+
+  while(1)
+  {
+    OSTimeDly((ETHIF_LINK_POLL_MS * OS_CFG_TICK_RATE_HZ) / 1000u,
+              OS_OPT_TIME_DLY,
+              &err);
+    ethernetif_notify_conn_changed(netif);
   }
+}
+#endif /* ETHIF_LINK_MONITOR */
+
+/**
+ * 检查PHY的连接状态并更新netif，不再重新初始化MAC。
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ */
+void ethernetif_notify_conn_changed(struct netif *netif)
+{
+  LOCK_TCPIP_CORE();
+  ethernetif_link_update(netif);
+  UNLOCK_TCPIP_CORE();
 }
\ No newline at end of file
@@ -34,6 +34,80 @@
 
 /* Within 'USER CODE' section, code will be kept by default at each generation */
 /* USER CODE BEGIN 0 */
+/* 驱动配置的默认值，需要修改时在lwipopts.h中定义 */
+#ifndef ETHIF_RX_ZERO_COPY
+#define ETHIF_RX_ZERO_COPY 0
+#endif
+#ifndef ETHIF_RX_BUF_CNT
+#define ETHIF_RX_BUF_CNT (2 * ETHIF_RX_DESC_MAX)
+#endif
+#ifndef ETHIF_TX_ZERO_COPY
+#define ETHIF_TX_ZERO_COPY 0
+#endif
+#ifndef ETHIF_RX_BATCH
+#define ETHIF_RX_BATCH 0
+#endif
+#ifndef ETHIF_RX_BUDGET
+#define ETHIF_RX_BUDGET 8
+#endif
+#ifndef ETHIF_RX_DESC_MAX
+#define ETHIF_RX_DESC_MAX ETH_RXBUFNB
+#endif
+#ifndef ETHIF_TX_DESC_MAX
+#define ETHIF_TX_DESC_MAX ETH_TXBUFNB
+#endif
+#ifndef ETHIF_DMA_SECTION
+#define ETHIF_DMA_SECTION
+#endif
+#ifndef ETHIF_TX_QUEUE_LEN
+#define ETHIF_TX_QUEUE_LEN 0
+#endif
+#ifndef ETHIF_PTP
+#define ETHIF_PTP 0
+#endif
+#ifndef ETHIF_PTP_TS_CNT
+#define ETHIF_PTP_TS_CNT 8
+#endif
+#ifndef ETHIF_RX_COALESCE
+#define ETHIF_RX_COALESCE 0
+#endif
+#ifndef ETHIF_RX_COALESCE_FRAMES
+#define ETHIF_RX_COALESCE_FRAMES 2
+#endif
+#ifndef ETHIF_RX_COALESCE_USEC
+#define ETHIF_RX_COALESCE_USEC 100
+#endif
+#ifndef ETHIF_LINK_MONITOR
+#define ETHIF_LINK_MONITOR 1
+#endif
+#ifndef ETHIF_LINK_POLL_MS
+#define ETHIF_LINK_POLL_MS 500
+#endif
+
+/* 收发描述符环的统计信息，用于根据实际数据调整环的深度 */
+typedef struct
+{
+  uint32_t RxDescCnt;       /* 接收描述符数量 */
+  uint32_t TxDescCnt;       /* 发送描述符数量 */
+  uint32_t RxHighWater;     /* 接收环中同时等待处理的描述符最大数量 */
+  uint32_t TxHighWater;     /* 发送环中同时被DMA持有的描述符最大数量 */
+  uint32_t RxBufUnavail;    /* 接收描述符用完(RBUS)的次数 */
+  uint32_t RxMissed;        /* 接收描述符用完期间MAC丢弃的帧数 */
+  uint32_t TxUnderflow;     /* 发送下溢(TUS)的次数 */
+  uint32_t RxNoPbuf;        /* 没有pbuf而丢弃的帧数 */
+  uint32_t TxBusy;          /* 描述符仍被DMA持有，low_level_output()返回ERR_USE的次数 */
+  uint32_t TxQueueHighWater;/* 发送队列中同时排队的帧最大数量 */
+  uint32_t TxQueueDrop;     /* 发送队列已满而丢弃的帧数 */
+  uint32_t RxIrq;           /* 接收中断次数 */
+  uint32_t RxFrames;        /* 接收到的帧数 */
+} ETH_RingStatsTypeDef;
+
+/* PTP时间，NanoSeconds小于1000000000 */
+typedef struct
+{
+  uint32_t Seconds;
+  uint32_t NanoSeconds;
+} ETH_PtpTimeTypeDef;
 
 /* USER CODE END 0 */
 
@@ -49,7 +123,21 @@ u32_t sys_jiffies(void);
 u32_t sys_now(void);
 
 /* USER CODE BEGIN 1 */
+extern ETH_RingStatsTypeDef ETH_RingStats;
 
+void ethernetif_set_ring_size(uint32_t rxcnt, uint32_t txcnt);
+#if ETHIF_RX_COALESCE
+void ethernetif_set_rx_coalesce(uint32_t frames, uint32_t usec);
+#endif
+
+#if ETHIF_PTP
+void  ethernetif_ptp_get_time(ETH_PtpTimeTypeDef *ts);
+void  ethernetif_ptp_set_time(const ETH_PtpTimeTypeDef *ts);
+void  ethernetif_ptp_adjust_time(int64_t offset);
+void  ethernetif_ptp_adjust_freq(int32_t ppb);
+err_t ethernetif_ptp_get_rx_timestamp(struct pbuf *p, ETH_PtpTimeTypeDef *ts);
+err_t ethernetif_ptp_get_tx_timestamp(struct pbuf *p, ETH_PtpTimeTypeDef *ts);
+#endif
 /* USER CODE END 1 */
 #endif
 
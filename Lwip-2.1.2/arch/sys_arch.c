@@ -36,47 +36,173 @@
 #include "lwip/sys.h"
 #include "lwip/mem.h"
 #include "lwip/stats.h"
-#include "lwip/apps/snmp_opts.h"
 #include "string.h"
+#include "stm32f4xx_hal.h"
 
 #if defined(LWIP_PROVIDE_ERRNO)
 int errno;
 #endif
 
+/* sys_sem_valid()和sys_mbox_valid()根据uCOS对象的Type判断对象是否存在 */
+#if OS_OBJ_TYPE_REQ == 0u
+#error "sys_arch needs OS_CFG_OBJ_TYPE_CHK_EN or OS_CFG_DBG_EN"
+#endif
+
 /* ---------------------------lwIP用到的系统资源------------------------ */
+#if SYS_LIGHTWEIGHT_PROT && !SYS_ARCH_PROT_CRITICAL
 sys_mutex_t LwIP_Mutex_Arch;
+#endif
+#if LWIP_NETCONN_SEM_PER_THREAD
+static OS_REG_ID NetconnSemRegId = OS_CFG_TASK_REG_TBL_SIZE;    //保存netconn信号量的任务寄存器
+#endif
 
 /* --------------------------------任务资源---------------------------- */
-OS_TCB    TCPIP_TaskTCB;
-CPU_STK   TCPIP_TaskSTK[TCPIP_THREAD_STACKSIZE];
+/* sys_thread_new()的任务槽由SYS_THREAD_SLOTS表定义，每个槽一个TCB和一段固定大小的任务栈，
+ * 各槽的任务栈依次排在SysThreadStk中。任务占用表中同名的槽，没有同名槽时占用第一个空闲的、
+ * 栈不小于调用者要求的通用槽。lwIP的任务创建后不会退出，所以只分配不回收，不使用堆 */
+typedef struct
+{
+  const char   *name;       //任务名，NULL为通用槽
+  CPU_STK_SIZE  stk_size;
+} sys_thread_cfg_t;
+
+typedef struct
+{
+  OS_TCB        tcb;
+  CPU_STK      *stk;        //NULL表示槽空闲
+  const char   *name;       //占用这个槽的任务名
+} sys_thread_slot_t;
+
+/* 栈大小取偶数个CPU_STK，各槽的栈顶保持8字节对齐，uCOS的Cortex-M移植要求 */
+#define SYS_THREAD_STK_ALIGN(size)    (((CPU_STK_SIZE)(size) + 1u) & ~(CPU_STK_SIZE)1u)
+
+#define SYS_THREAD_SLOT(name, size)   {(name), SYS_THREAD_STK_ALIGN(size)},
+static const sys_thread_cfg_t SysThreadCfg[] = { SYS_THREAD_SLOTS };
+#undef SYS_THREAD_SLOT
+#define SYS_THREAD_MAX                ((u8_t)(sizeof(SysThreadCfg) / sizeof(SysThreadCfg[0])))
+
+static SYS_THREAD_SECTION sys_thread_slot_t SysThreadTbl[SYS_THREAD_MAX];
+#define SYS_THREAD_SLOT(name, size)   + SYS_THREAD_STK_ALIGN(size)
+static SYS_THREAD_SECTION CPU_STK SysThreadStk[0 SYS_THREAD_SLOTS];
+#undef SYS_THREAD_SLOT
+static const char *SysThreadFailName = NULL;   //创建失败的任务名，调试器中查看
+
+static void sys_now_us_init(void);
+
+#if SYS_ARCH_OBJ_DBG
+sys_arch_obj_dbg_t SysArchObjDbg;
+
+static void
+sys_arch_obj_dbg_inc(u32_t *cnt)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  (*cnt)++;
+  CPU_CRITICAL_EXIT();
+}
+#define SYS_ARCH_OBJ_DBG_INC(x) sys_arch_obj_dbg_inc(&SysArchObjDbg.x)
+#else
+#define SYS_ARCH_OBJ_DBG_INC(x)
+#endif /* SYS_ARCH_OBJ_DBG */
 
 /* Initialize this module (see description in sys.h) */
 void
 sys_init(void)
 {
+#if (SYS_LIGHTWEIGHT_PROT && !SYS_ARCH_PROT_CRITICAL) || LWIP_NETCONN_SEM_PER_THREAD
   OS_ERR err;
+#endif
+
+#if SYS_LIGHTWEIGHT_PROT && !SYS_ARCH_PROT_CRITICAL
   /* initialize sys_arch_protect global mutex */
   OSMutexCreate(&LwIP_Mutex_Arch,
                 "LwIP Mutex Arch",
                 &err);
 
   LWIP_ASSERT("failed to create LwIP_Mutex_Arch mutex",
-              err != OS_ERR_NONE);
+              err == OS_ERR_NONE);
+#endif
+#if LWIP_NETCONN_SEM_PER_THREAD
+  /* 分配保存每个任务netconn信号量的任务寄存器 */
+  NetconnSemRegId = OSTaskRegGetID(&err);
+  LWIP_ASSERT("failed to allocate the netconn sem task register",
+              err == OS_ERR_NONE);
+#endif
+
+  sys_now_us_init();
 }
 
+/* 动态节拍模式下OSTickCtr只在定时器中断中更新，OSTimeGet()会加上上次中断之后已经过去的节拍 */
 u32_t
 sys_now(void)
 {
-  return OSTickCtr;
+  OS_ERR err;
+
+  return OSTimeGet(&err);
 }
 
 u32_t
 sys_jiffies(void)
 {
-  return OSTickCtr;
+  return sys_now();
+}
+
+/* 微秒时钟：32位定时器SYS_NOW_US_TIM分频到1MHz后自由计数，约71分钟回绕一次，
+ * 睡眠模式下外设时钟不停，计数不受影响 */
+static void
+sys_now_us_init(void)
+{
+  uint32_t clk;
+
+  SYS_NOW_US_TIM_CLK_ENABLE();
+
+  /* APB1分频系数不为1时定时器时钟是PCLK1的2倍 */
+  clk = HAL_RCC_GetPCLK1Freq();
+  if((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1)
+  {
+    clk *= 2U;
+  }
+
+  SYS_NOW_US_TIM->CR1 = 0;
+  SYS_NOW_US_TIM->PSC = clk / 1000000U - 1U;
+  SYS_NOW_US_TIM->ARR = 0xFFFFFFFFU;
+  SYS_NOW_US_TIM->CNT = 0;
+  SYS_NOW_US_TIM->EGR = TIM_EGR_UG;       //立即装载分频系数
+  SYS_NOW_US_TIM->CR1 = TIM_CR1_CEN;
+}
+
+u32_t
+sys_now_us(void)
+{
+  return SYS_NOW_US_TIM->CNT;
 }
 
 #if SYS_LIGHTWEIGHT_PROT
+#if SYS_ARCH_PROT_CRITICAL
+
+/* 进入uC-CPU的临界区，用BASEPRI屏蔽内核管理的中断，返回进入前的BASEPRI。
+ * 嵌套调用时内层保存的是外层设置的值，退出时逐层恢复，所以可以嵌套，也可以在中断中调用 */
+sys_prot_t
+sys_arch_protect(void)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+
+  return (sys_prot_t)cpu_sr;
+}
+
+void
+sys_arch_unprotect(sys_prot_t pval)
+{
+  CPU_SR_ALLOC();
+
+  cpu_sr = (CPU_SR)pval;
+  CPU_CRITICAL_EXIT();
+}
+
+#else /* SYS_ARCH_PROT_CRITICAL */
 
 sys_prot_t
 sys_arch_protect(void)
@@ -107,6 +233,7 @@ sys_arch_unprotect(sys_prot_t pval)
   LWIP_ASSERT("LwIP_Mutex_Arch failed to give the mutex", err == OS_ERR_NONE);
 }
 
+#endif /* SYS_ARCH_PROT_CRITICAL */
 #endif /* SYS_LIGHTWEIGHT_PROT */
 
 #if LWIP_COMPAT_MUTEX == 0        //LWIP_COMPAT_MUTEX == 1代表使用兼容的mutex，既使用sem代替mutex
@@ -196,6 +323,7 @@ sys_sem_new(sys_sem_t *sem, u8_t initial_count)
     return ERR_MEM;
   }
   SYS_STATS_INC_USED(sem);
+  SYS_ARCH_OBJ_DBG_INC(sem_new);
 
   return ERR_OK;
 }
@@ -208,7 +336,11 @@ sys_sem_signal(sys_sem_t *sem)
   OSSemPost(sem,
             OS_OPT_POST_1,
             &err);
-  
+
+  if(err == OS_ERR_OBJ_TYPE)
+  {
+    SYS_ARCH_OBJ_DBG_INC(post_invalid);
+  }
   /* queue full is OK, this is a signal only... */
   LWIP_ASSERT("sys_sem_signal: sane return value",
     err == OS_ERR_NONE);
@@ -218,7 +350,7 @@ u32_t
 sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout_ms)
 {
   OS_ERR err;
-  OS_TICK starttick = OSTickCtr;
+  OS_TICK starttick = sys_now();
 
   OSSemPend(sem,
             timeout_ms,
@@ -235,7 +367,7 @@ sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout_ms)
   /* Old versions of lwIP required us to return the time waited.
      This is not the case any more. Just returning != SYS_ARCH_TIMEOUT
      here is enough. */
-  return OSTickCtr - starttick;       //in case of warning
+  return sys_now() - starttick;       //in case of warning
 }
 
 void
@@ -250,47 +382,214 @@ sys_sem_free(sys_sem_t *sem)
   if(err == OS_ERR_NONE)
   {
     SYS_STATS_DEC(sem.used);
+    SYS_ARCH_OBJ_DBG_INC(sem_free);
   }
   else
   {
+    SYS_ARCH_OBJ_DBG_INC(free_invalid);
     LWIP_ASSERT("fail to delete the sem", 0);
   }
 }
 
-int sys_sem_valid(sys_sem_t *sem)
+/* OSSemCreate()把Type置为OS_OBJ_TYPE_SEM，OSSemDel()置为OS_OBJ_TYPE_NONE，
+ * lwIP的netconn等结构体从内存池分配，删除后再分配时Type不会是OS_OBJ_TYPE_SEM */
+int
+sys_sem_valid(sys_sem_t *sem)
 {
-  if (sem == SYS_SEM_NULL)
+  if(sem == SYS_SEM_NULL)
+  {
     return 0;
-  else
-    return 1;
+  }
+  return (sem->Type == OS_OBJ_TYPE_SEM);
+}
+
+/* 只在对象已经删除或创建失败后调用，uCOS内部不再引用它，直接改Type即可 */
+void
+sys_sem_set_invalid(sys_sem_t *sem)
+{
+  if(sem != SYS_SEM_NULL)
+  {
+    sem->Type = OS_OBJ_TYPE_NONE;
+  }
 }
 
-void sys_sem_set_invalid(sys_sem_t *sem)
+/* 邮箱由一个void *环形缓冲区和一个信号量组成，环形缓冲区在临界区内读写，不使用OS_Q，
+ * 也不占用uCOS的全局消息池OS_MsgPool。
+ * 信号量只用于等待：邮箱空时取消息的任务、邮箱满时发消息的任务登记后在信号量上等待，
+ * 另一方改变邮箱状态时发现有任务在等待才post信号量。等待的任务醒来后重新检查邮箱，
+ * 所以多post的信号量只会造成一次多余的唤醒，不会丢消息 */
+
+/* 从临界区内登记等待开始计算，返回剩余的等待时间，0表示一直等待，超时返回SYS_ARCH_TIMEOUT */
+static u32_t
+sys_mbox_wait_ticks(OS_TICK starttick, u32_t timeout_ms)
 {
-  sem = SYS_SEM_NULL;
+  OS_TICK elapsetick;
+
+  if(timeout_ms == 0)
+  {
+    return 0;
+  }
+  elapsetick = sys_now() - starttick;
+  if(elapsetick >= timeout_ms)
+  {
+    return SYS_ARCH_TIMEOUT;
+  }
+  return timeout_ms - elapsetick;
+}
+
+/* 在邮箱的信号量上等待ticks个节拍，醒来后注销登记。
+ * 邮箱在等待期间被删除时返回0，调用者不能再访问邮箱 */
+static int
+sys_mbox_wait(sys_mbox_t *mbox, u8_t *waiters, u32_t ticks)
+{
+  OS_ERR err;
+  CPU_SR_ALLOC();
+
+  OSSemPend(&(mbox->wait_sem),
+            ticks,
+            OS_OPT_PEND_BLOCKING,
+            0,
+            &err);
+
+  if((err == OS_ERR_OBJ_DEL) || (err == OS_ERR_OBJ_TYPE))
+  {
+    return 0;
+  }
+  CPU_CRITICAL_ENTER();
+  (*waiters)--;
+  CPU_CRITICAL_EXIT();
+  return 1;
+}
+
+/* 有任务在等待时唤醒其中一个 */
+static void
+sys_mbox_wake(sys_mbox_t *mbox)
+{
+  OS_ERR err;
+
+  OSSemPost(&(mbox->wait_sem),
+            OS_OPT_POST_1,
+            &err);
+}
+
+/* 在临界区内放入一条消息，邮箱满返回0 */
+static int
+sys_mbox_put(sys_mbox_t *mbox, void *msg)
+{
+  u16_t tail;
+  int wake;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  if(mbox->count >= mbox->size)
+  {
+    CPU_CRITICAL_EXIT();
+    return 0;
+  }
+  tail = mbox->head + mbox->count;
+  if(tail >= mbox->size)
+  {
+    tail -= mbox->size;
+  }
+  mbox->msg[tail] = msg;
+  mbox->count++;
+  if(mbox->count > mbox->count_max)
+  {
+    mbox->count_max = mbox->count;
+  }
+  wake = (mbox->rx_waiters != 0);
+  CPU_CRITICAL_EXIT();
+
+  if(wake)
+  {
+    sys_mbox_wake(mbox);
+  }
+  return 1;
+}
+
+/* 在临界区内取出一条消息，先取高优先级队列，邮箱空返回0。
+ * 高优先级队列只能用sys_mbox_trypost_prio()发送，没有等待发送的任务 */
+static int
+sys_mbox_get(sys_mbox_t *mbox, void **msg)
+{
+  int wake;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  if(mbox->hi_count != 0)
+  {
+    *msg = mbox->msg[mbox->size + mbox->hi_head];
+    if(++mbox->hi_head == mbox->hi_size)
+    {
+      mbox->hi_head = 0;
+    }
+    mbox->hi_count--;
+    CPU_CRITICAL_EXIT();
+    return 1;
+  }
+  if(mbox->count == 0)
+  {
+    CPU_CRITICAL_EXIT();
+    return 0;
+  }
+  *msg = mbox->msg[mbox->head];
+  if(++mbox->head == mbox->size)
+  {
+    mbox->head = 0;
+  }
+  mbox->count--;
+  wake = (mbox->tx_waiters != 0);
+  CPU_CRITICAL_EXIT();
+
+  if(wake)
+  {
+    sys_mbox_wake(mbox);
+  }
+  return 1;
 }
 
 err_t
 sys_mbox_new(sys_mbox_t *mbox, int size)
 {
-  OS_ERR err0, err1;
+  return sys_mbox_new_prio(mbox, size, 0);
+}
+
+/* 创建两级邮箱，size为普通队列的深度，hi_size为高优先级队列的深度，两者之和不能超过SYS_MBOX_SIZE_MAX */
+err_t
+sys_mbox_new_prio(sys_mbox_t *mbox, int size, int hi_size)
+{
+  OS_ERR err;
 
-  OSQCreate(&(mbox->msg_queen),
-            "LwIP MSQ",
-            size,
-            &err0);
+  if((size <= 0) || (hi_size < 0) || (size + hi_size > SYS_MBOX_SIZE_MAX)) {
+    SYS_STATS_INC(mbox.err);
+    LWIP_ASSERT("mbox size invalid", 0);
+    return ERR_MEM;
+  }
 
-  OSSemCreate(&(mbox->msg_sem),
-              "LwIP MSQ_SEM",
-              size,
-              &err1);
+  mbox->size = (u16_t)size;
+  mbox->head = 0;
+  mbox->count = 0;
+  mbox->hi_size = (u16_t)hi_size;
+  mbox->hi_head = 0;
+  mbox->hi_count = 0;
+  mbox->count_max = 0;
+  mbox->hi_count_max = 0;
+  mbox->rx_waiters = 0;
+  mbox->tx_waiters = 0;
+
+  /* 邮箱是否有效由wait_sem的Type决定，见sys_mbox_valid() */
+  OSSemCreate(&(mbox->wait_sem),
+              "LwIP MBOX",
+              0,
+              &err);
 
-  if((err0 != OS_ERR_NONE) ||(err1 != OS_ERR_NONE)) {
+  if(err != OS_ERR_NONE) {
     SYS_STATS_INC(mbox.err);
     LWIP_ASSERT("fail to creat the mbox", 0);
     return ERR_MEM;
   }
   SYS_STATS_INC_USED(mbox);
+  SYS_ARCH_OBJ_DBG_INC(mbox_new);
   return ERR_OK;
 }
 
@@ -300,164 +599,163 @@ sys_mbox_new(sys_mbox_t *mbox, int size)
 void
 sys_mbox_post(sys_mbox_t *mbox, void *msg)
 {
-  OS_ERR err;
+  CPU_SR_ALLOC();
 
-  OSSemPend(&(mbox->msg_sem),
-            0,
-            OS_OPT_PEND_BLOCKING,
-            0,
-            &err);
-  if(err != OS_ERR_NONE)
+  if(!sys_mbox_valid(mbox))
   {
-    LWIP_ASSERT("mbox post failed", 0);
+    SYS_ARCH_OBJ_DBG_INC(post_invalid);
+    LWIP_ASSERT("sys_mbox_post: invalid mbox", 0);
     return;
   }
 
-  OSQPost(&(mbox->msg_queen),
-          msg,
-          sizeof(void *),
-          OS_OPT_POST_FIFO,
-          &err);
-  LWIP_ASSERT("mbox post failed", err == OS_ERR_NONE);
+  while(!sys_mbox_put(mbox, msg))
+  {
+    /* 登记后再检查一次，避免在两次检查之间取走消息的任务看不到等待者 */
+    CPU_CRITICAL_ENTER();
+    if(mbox->count < mbox->size)
+    {
+      CPU_CRITICAL_EXIT();
+      continue;
+    }
+    mbox->tx_waiters++;
+    CPU_CRITICAL_EXIT();
+
+    if(!sys_mbox_wait(mbox, &(mbox->tx_waiters), 0))
+    {
+      return;
+    }
+  }
 }
 
 /* 非阻塞调用
- * 如果消息队列满了也直接返回，可以在中断中调用
- * uCos-III支持中断调用OSQPost() */
+ * 如果消息队列满了也直接返回，可以在中断中调用 */
 err_t
 sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
 {
-  OS_ERR err;
-
-  OSQPost(&(mbox->msg_queen),
-          msg,
-          sizeof(void *),
-          OS_OPT_POST_FIFO,
-          &err);
-  if(err != OS_ERR_NONE)
+  /* 已删除的邮箱环形缓冲区仍然可写，先检查，避免消息放进去以后没有人取 */
+  if(!sys_mbox_valid(mbox))
   {
-    LWIP_ASSERT("mbox trypost failed", 0);
-    SYS_STATS_INC(mbox.err);
-    return ERR_MEM; 
+    SYS_ARCH_OBJ_DBG_INC(post_invalid);
+    return ERR_ARG;
   }
-
-  // 在中断中调用该函数不知道会不会有问题
-  // 会检测是不是在中断中被调用，如果第三个参数是OS_OPT_PEND_NON_BLOCKING则不会返回错误
-  OSSemPend(&(mbox->msg_sem),
-            0,
-            OS_OPT_PEND_NON_BLOCKING,
-            0,
-            &err);
-  if(err != OS_ERR_NONE)
+  if(!sys_mbox_put(mbox, msg))
   {
-    LWIP_ASSERT("mbox trypost failed", 0);
+    SYS_STATS_INC(mbox.err);
     return ERR_MEM;
   }
 
-  return ERR_OK; 
+  return ERR_OK;
 }
 
-/* 在引用该函数的地方提到
- *Same as @ref tcpip_callbackmsg_trycallback but calls sys_mbox_trypost_fromisr(),
- * mainly to help FreeRTOS, where calls differ between task level and ISR level. 
- * 因此他的实现保持和sys_mbox_trypost()一致 */
+/* 非阻塞调用，消息放入高优先级队列，队列满时返回ERR_MEM，不会借用普通队列，
+ * 以免同一类消息的顺序被打乱。可以在中断中调用 */
 err_t
-sys_mbox_trypost_fromisr(sys_mbox_t *mbox, void *msg)
+sys_mbox_trypost_prio(sys_mbox_t *mbox, void *msg)
 {
-  OS_ERR err;
+  u16_t tail;
+  int wake;
+  CPU_SR_ALLOC();
 
-  OSQPost(&(mbox->msg_queen),
-          msg,
-          sizeof(void *),
-          OS_OPT_POST_FIFO,
-          &err);
-  if(err != OS_ERR_NONE)
+  if(!sys_mbox_valid(mbox))
   {
-    LWIP_ASSERT("mbox trypost failed", 0);
-    SYS_STATS_INC(mbox.err);
-    return ERR_MEM; 
+    SYS_ARCH_OBJ_DBG_INC(post_invalid);
+    return ERR_ARG;
   }
 
-  // 在中断中调用该函数不知道会不会有问题
-  // 会检测是不是在中断中被调用，如果第三个参数是OS_OPT_PEND_NON_BLOCKING则不会返回错误
-  OSSemPend(&(mbox->msg_sem),
-            0,
-            OS_OPT_PEND_NON_BLOCKING,
-            0,
-            &err);
-  if(err != OS_ERR_NONE)
+  CPU_CRITICAL_ENTER();
+  if(mbox->hi_count >= mbox->hi_size)
   {
-    LWIP_ASSERT("mbox trypost failed", 0);
+    CPU_CRITICAL_EXIT();
+    SYS_STATS_INC(mbox.err);
     return ERR_MEM;
   }
+  tail = mbox->hi_head + mbox->hi_count;
+  if(tail >= mbox->hi_size)
+  {
+    tail -= mbox->hi_size;
+  }
+  mbox->msg[mbox->size + tail] = msg;
+  mbox->hi_count++;
+  if(mbox->hi_count > mbox->hi_count_max)
+  {
+    mbox->hi_count_max = mbox->hi_count;
+  }
+  wake = (mbox->rx_waiters != 0);
+  CPU_CRITICAL_EXIT();
+
+  if(wake)
+  {
+    sys_mbox_wake(mbox);
+  }
+  return ERR_OK;
+}
+
+/* 读取两级队列的当前深度和最大深度 */
+void
+sys_mbox_get_depth(sys_mbox_t *mbox, u16_t *count, u16_t *hi_count, u16_t *count_max, u16_t *hi_count_max)
+{
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  *count = mbox->count;
+  *hi_count = mbox->hi_count;
+  *count_max = mbox->count_max;
+  *hi_count_max = mbox->hi_count_max;
+  CPU_CRITICAL_EXIT();
+}
 
-  return ERR_OK; 
+/* 在引用该函数的地方提到
+ *Same as @ref tcpip_callbackmsg_trycallback but calls sys_mbox_trypost_fromisr(),
+ * mainly to help FreeRTOS, where calls differ between task level and ISR level. 
+ * 环形缓冲区只在临界区内读写，uCOS-III也允许在中断中post信号量，因此实现和sys_mbox_trypost()一致 */
+err_t
+sys_mbox_trypost_fromisr(sys_mbox_t *mbox, void *msg)
+{
+  return sys_mbox_trypost(mbox, msg);
 }
 
 /* 阻塞调用，在timeout_ms超时时间内一直阻塞 */
 u32_t
 sys_arch_mbox_fetch(sys_mbox_t *mbox, void **msg, u32_t timeout_ms)
 {
-  OS_ERR err;
-  OS_MSG_SIZE size = 0;
-  OS_TICK starttick = OSTickCtr;
-  OS_TICK elapsetick = 0;
-  
-  *msg = OSQPend(&(mbox->msg_queen),
-                 timeout_ms,
-                 OS_OPT_PEND_BLOCKING,
-                 &size,
-                 0,
-                 &err);
-  elapsetick = OSTickCtr - starttick;
-  if(err != OS_ERR_NONE)    //从队列中取消息失败
-  {
-    LWIP_ASSERT("mbox fetch failed", 0);
-    *msg = NULL;
-    return SYS_ARCH_TIMEOUT;
-  }
-  else      //从队列里取消息成功
+  OS_TICK starttick = sys_now();
+  u32_t ticks;
+  CPU_SR_ALLOC();
+
+  while(!sys_mbox_get(mbox, msg))
   {
-    OSSemPost(&(mbox->msg_sem),
-              OS_OPT_POST_1,
-              &err);
-    if(err != OS_ERR_NONE)
+    ticks = sys_mbox_wait_ticks(starttick, timeout_ms);
+    if(ticks == SYS_ARCH_TIMEOUT)
     {
-      LWIP_ASSERT("mbox sem operation error", 0);
+      *msg = NULL;
+      return SYS_ARCH_TIMEOUT;
+    }
+
+    CPU_CRITICAL_ENTER();
+    if((mbox->count != 0) || (mbox->hi_count != 0))
+    {
+      CPU_CRITICAL_EXIT();
+      continue;
+    }
+    mbox->rx_waiters++;
+    CPU_CRITICAL_EXIT();
+
+    if(!sys_mbox_wait(mbox, &(mbox->rx_waiters), ticks))
+    {
+      *msg = NULL;
       return SYS_ARCH_TIMEOUT;
     }
   }
 
-  return elapsetick;
+  return sys_now() - starttick;
 }
 
 /* 非阻塞调用 */
 u32_t
 sys_arch_mbox_tryfetch(sys_mbox_t *mbox, void **msg)
 {
-  OS_ERR err;
-  OS_MSG_SIZE size = 0;
-
-  *msg = OSQPend(&(mbox->msg_queen),
-                 0,
-                 OS_OPT_PEND_NON_BLOCKING,
-                 &size,
-                 0,
-                 &err);
-  if(err != OS_ERR_NONE)
+  if(!sys_mbox_get(mbox, msg))
   {
-    msg = NULL;
-    LWIP_ASSERT("mbox tryfetch failed", 0);
-    return SYS_MBOX_EMPTY;
-  }
-
-  OSSemPost(&(mbox->msg_sem),
-            OS_OPT_POST_1,
-            &err);
-  if(err != OS_ERR_NONE)
-  {
-    msg = NULL;
-    LWIP_ASSERT("mbox tryfetch failed", 0);
     return SYS_MBOX_EMPTY;
   }
 
@@ -472,119 +770,223 @@ sys_mbox_free(sys_mbox_t *mbox)
 {
   OS_ERR err;
 
-  OSSemDel(&(mbox->msg_sem),
+  LWIP_ASSERT("sys_mbox_free: mbox not empty", (mbox->count == 0) && (mbox->hi_count == 0));
+
+  /* 还在等待的任务被唤醒并得到OS_ERR_OBJ_DEL，按超时返回 */
+  OSSemDel(&(mbox->wait_sem),
            OS_OPT_DEL_ALWAYS,
            &err);
-  LWIP_ASSERT("sys_mbox_free failed", err == OS_ERR_NONE);
-
-  OSQDel(&(mbox->msg_queen),
-         OS_OPT_DEL_ALWAYS,
-         &err);
-  LWIP_ASSERT("sys_mbox_free failed", err == OS_ERR_NONE);   
+  if(err != OS_ERR_NONE)
+  {
+    SYS_ARCH_OBJ_DBG_INC(free_invalid);
+    LWIP_ASSERT("sys_mbox_free failed", 0);
+    return;
+  }
 
   SYS_STATS_DEC(mbox.used);
+  SYS_ARCH_OBJ_DBG_INC(mbox_free);
 }
 
-int sys_mbox_valid(sys_mbox_t *mbox)
+int
+sys_mbox_valid(sys_mbox_t *mbox)
 {
-  if (mbox == SYS_MBOX_NULL)
+  if(mbox == SYS_MBOX_NULL)
+  {
     return 0;
-  else
-    return 1;
+  }
+  return (mbox->wait_sem.Type == OS_OBJ_TYPE_SEM);
 }
 
-void sys_mbox_set_invalid(sys_mbox_t *mbox)
+void
+sys_mbox_set_invalid(sys_mbox_t *mbox)
 {
-  mbox = SYS_MBOX_NULL;
+  if(mbox != SYS_MBOX_NULL)
+  {
+    mbox->wait_sem.Type = OS_OBJ_TYPE_NONE;
+  }
+}
+
+/* 任务池不够或者任务创建失败。LWIP_NOASSERT时断言不起作用，如果直接返回，协议栈的任务不存在
+ * 却看不出任何异常，所以记下任务名后停在这里 */
+static void
+sys_thread_fail(const char *name, const char *msg)
+{
+  SysThreadFailName = name;
+  LWIP_ASSERT(msg, 0);
+  LWIP_UNUSED_ARG(msg);
+  while(1);     //STOP if error
+}
+
+/* 为任务name找一个空闲的槽：表中同名的槽(栈大小以表为准)，或者第一个栈足够大的通用槽，
+ * 找不到时返回SYS_THREAD_MAX。*stk_off返回这个槽的任务栈在SysThreadStk中的位置 */
+static u8_t
+sys_thread_slot_find(const char *name, int stacksize, CPU_STK_SIZE *stk_off)
+{
+  u8_t i;
+  u8_t generic = SYS_THREAD_MAX;
+  CPU_STK_SIZE off = 0;
+  CPU_STK_SIZE generic_off = 0;
+
+  for(i = 0; i < SYS_THREAD_MAX; i++)
+  {
+    if(SysThreadTbl[i].stk == NULL)
+    {
+      if(SysThreadCfg[i].name == NULL)
+      {
+        if((generic == SYS_THREAD_MAX) && (SysThreadCfg[i].stk_size >= (CPU_STK_SIZE)stacksize))
+        {
+          generic = i;
+          generic_off = off;
+        }
+      }
+      else if((name != NULL) && (strcmp(SysThreadCfg[i].name, name) == 0))
+      {
+        *stk_off = off;
+        return i;
+      }
+    }
+    off += SysThreadCfg[i].stk_size;
+  }
+  *stk_off = generic_off;
+  return generic;
 }
 
 sys_thread_t
 sys_thread_new(const char *name, lwip_thread_fn thread, void *arg, int stacksize, int prio)
+{
+  OS_ERR err;
+  sys_thread_slot_t *slot;
+  CPU_STK_SIZE stk_size;
+  CPU_STK_SIZE stk_off;
+  u8_t idx;
+  CPU_SR_ALLOC();
+
+  CPU_CRITICAL_ENTER();
+  idx = sys_thread_slot_find(name, stacksize, &stk_off);
+  if(idx >= SYS_THREAD_MAX)
+  {
+    CPU_CRITICAL_EXIT();
+    sys_thread_fail(name, "sys_thread_new: no free thread slot, add one to SYS_THREAD_SLOTS");
+    return;
+  }
+  slot = &SysThreadTbl[idx];
+  slot->stk = &SysThreadStk[stk_off];
+  slot->name = name;
+  stk_size = SysThreadCfg[idx].stk_size;
+  CPU_CRITICAL_EXIT();
+
+  OSTaskCreate((OS_TCB        *)&slot->tcb,              //任务控制块
+               (CPU_CHAR      *)name,                     //任务名
+               (OS_TASK_PTR    )thread,                   //任务函数地址
+               (void          *)arg,                      //传递给任务的参数
+               (OS_PRIO        )prio,                     //任务优先级
+               (CPU_STK       *)slot->stk,               //任务栈基地址
+               (CPU_STK_SIZE   )stk_size / 10,            //任务栈的深度标记，当未使用的栈空间仅剩10%时就达到栈的极限深度
+               (CPU_STK_SIZE   )stk_size,                 //任务栈大小
+               (OS_MSG_QTY     )0,                        //任务内部消息队列能接受的消息的最大数目
+               (OS_TICK        )0,                        //使能时间片调度时，这个参数指定时间片长度，如果为0，则为默认时间片长度（时钟节拍频率除以10）
+               (void          *)0,                        //任务补充储存器地址，用来扩展任务的TCB，比如在任务切换时，可以用补充储存区的空间来存放浮点运算寄存器的内容
+               (OS_OPT         )(OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),
+                /*  定义如下：
+                OS_OPT_TASK_NONE         没有选择任何项
+                OS_OPT_TASK_STK_CHK      使能检测任务栈，统计任务栈已用的和未用的
+                OS_OPT_TASK_STK_CLR      在创建任务时，清零任务栈
+                OS_OPT_TASK_SAVE_FP      如果CPU有浮点寄存器，则在任务切换时保存浮点寄存器的内容
+                */
+               (OS_ERR        *)&err);
+
+  if(err != OS_ERR_NONE)
+  {
+    sys_thread_fail(name, "sys_thread_new: task creation failed");
+  }
+}
+
+#if OS_CFG_STAT_TASK_STK_CHK_EN > 0u
+/* 读取第idx个任务槽中的任务名和栈使用情况(单位CPU_STK)，idx超出SYS_THREAD_SLOTS表时返回ERR_ARG，
+ * 槽空闲时返回ERR_VAL */
+err_t
+sys_arch_thread_stk_chk(u8_t idx, const char **name, CPU_STK_SIZE *used, CPU_STK_SIZE *free)
 {
   OS_ERR err;
 
-  const char *taskname_tcpip = TCPIP_THREAD_NAME;
-  const char *taskname_snmp = SNMP_THREAD_NAME;
+  if(idx >= SYS_THREAD_MAX)
+  {
+    return ERR_ARG;
+  }
+  if(SysThreadTbl[idx].stk == NULL)
+  {
+    return ERR_VAL;
+  }
 
-  if(memcmp((void *)name, (void *)taskname_tcpip, 5) == 0)
+  OSTaskStkChk(&SysThreadTbl[idx].tcb, free, used, &err);
+  if(err != OS_ERR_NONE)
   {
-    OSTaskCreate((OS_TCB        *)&TCPIP_TaskTCB,          //任务控制块
-                 (CPU_CHAR      *)name,                     //任务名
-                 (OS_TASK_PTR    )thread,                   //任务函数地址
-                 (void          *)arg,                      //传递给任务的参数
-                 (OS_PRIO        )prio,                     //任务优先级
-                 (CPU_STK       *)TCPIP_TaskSTK,           //任务栈基地址
-                 (CPU_STK_SIZE   )stacksize / 10,           //任务栈的深度标记，当未使用的栈空间仅剩10%时就达到栈的极限深度
-                 (CPU_STK_SIZE   )stacksize,                //任务栈大小
-                 (OS_MSG_QTY     )0,                        //任务内部消息队列能接受的消息的最大数目
-                 (OS_TICK        )0,                        //使能时间片调度时，这个参数指定时间片长度，如果为0，则为默认时间片长度（时钟节拍频率除以10）
-                 (void          *)0,                        //任务补充储存器地址，用来扩展任务的TCB，比如在任务切换时，可以用补充储存区的空间来存放浮点运算寄存器的内容
-                 (OS_OPT         )(OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),
-                  /*  定义如下：
-                  OS_OPT_TASK_NONE         没有选择任何项
-					        OS_OPT_TASK_STK_CHK      使能检测任务栈，统计任务栈已用的和未用的
-					        OS_OPT_TASK_STK_CLR      在创建任务时，清零任务栈
-					        OS_OPT_TASK_SAVE_FP      如果CPU有浮点寄存器，则在任务切换时保存浮点寄存器的内容
-				          */
-                 (OS_ERR        *)&err);
+    return ERR_VAL;
   }
+  *name = SysThreadTbl[idx].name;
 
-  LWIP_ASSERT("task creation failed", err == OS_ERR_NONE);
+  return ERR_OK;
 }
+#endif /* OS_CFG_STAT_TASK_STK_CHK_EN > 0u */
 
 #if LWIP_NETCONN_SEM_PER_THREAD
-#if configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0
+#if OS_CFG_TASK_REG_TBL_SIZE > 0u
 
+/* 每个调用netconn/socket API的任务一个信号量，指针保存在任务寄存器NetconnSemRegId中，
+ * 任务第一次调用API时创建，之后每次调用都复用，不再为每个netconn创建和删除信号量 */
 sys_sem_t *
 sys_arch_netconn_sem_get(void)
 {
-  void* ret;
-  TaskHandle_t task = xTaskGetCurrentTaskHandle();
-  LWIP_ASSERT("task != NULL", task != NULL);
+  OS_ERR err;
+  sys_sem_t *sem;
+
+  LWIP_ASSERT("netconn sem register not allocated", NetconnSemRegId < OS_CFG_TASK_REG_TBL_SIZE);
 
-  ret = pvTaskGetThreadLocalStoragePointer(task, 0);
-  return ret;
+  sem = (sys_sem_t *)OSTaskRegGet((OS_TCB *)0, NetconnSemRegId, &err);
+  if(sem == NULL) {
+    /* 没有调用netconn_thread_init()的任务在第一次使用时创建 */
+    sys_arch_netconn_sem_alloc();
+    sem = (sys_sem_t *)OSTaskRegGet((OS_TCB *)0, NetconnSemRegId, &err);
+  }
+  return sem;
 }
 
 void
 sys_arch_netconn_sem_alloc(void)
 {
-  void *ret;
-  TaskHandle_t task = xTaskGetCurrentTaskHandle();
-  LWIP_ASSERT("task != NULL", task != NULL);
+  OS_ERR os_err;
+  sys_sem_t *sem;
+  err_t err;
 
-  ret = pvTaskGetThreadLocalStoragePointer(task, 0);
-  if(ret == NULL) {
-    sys_sem_t *sem;
-    err_t err;
+  sem = (sys_sem_t *)OSTaskRegGet((OS_TCB *)0, NetconnSemRegId, &os_err);
+  if(sem == NULL) {
     /* need to allocate the memory for this semaphore */
     sem = mem_malloc(sizeof(sys_sem_t));
     LWIP_ASSERT("sem != NULL", sem != NULL);
     err = sys_sem_new(sem, 0);
     LWIP_ASSERT("err == ERR_OK", err == ERR_OK);
-    LWIP_ASSERT("sem invalid", sys_sem_valid(sem));
-    vTaskSetThreadLocalStoragePointer(task, 0, sem);
+    OSTaskRegSet((OS_TCB *)0, NetconnSemRegId, (OS_REG)sem, &os_err);
+    LWIP_ASSERT("failed to set the task register", os_err == OS_ERR_NONE);
   }
 }
 
-void sys_arch_netconn_sem_free(void)
+void
+sys_arch_netconn_sem_free(void)
 {
-  void* ret;
-  TaskHandle_t task = xTaskGetCurrentTaskHandle();
-  LWIP_ASSERT("task != NULL", task != NULL);
+  OS_ERR os_err;
+  sys_sem_t *sem;
 
-  ret = pvTaskGetThreadLocalStoragePointer(task, 0);
-  if(ret != NULL) {
-    sys_sem_t *sem = ret;
+  sem = (sys_sem_t *)OSTaskRegGet((OS_TCB *)0, NetconnSemRegId, &os_err);
+  if(sem != NULL) {
     sys_sem_free(sem);
     mem_free(sem);
-    vTaskSetThreadLocalStoragePointer(task, 0, NULL);
+    OSTaskRegSet((OS_TCB *)0, NetconnSemRegId, 0, &os_err);
   }
 }
 
-#else /* configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0 */
-#error LWIP_NETCONN_SEM_PER_THREAD needs configNUM_THREAD_LOCAL_STORAGE_POINTERS
-#endif /* configNUM_THREAD_LOCAL_STORAGE_POINTERS > 0 */
+#else /* OS_CFG_TASK_REG_TBL_SIZE > 0u */
+#error LWIP_NETCONN_SEM_PER_THREAD needs OS_CFG_TASK_REG_TBL_SIZE
+#endif /* OS_CFG_TASK_REG_TBL_SIZE > 0u */
 
 #endif /* LWIP_NETCONN_SEM_PER_THREAD */
 
@@ -47,13 +47,95 @@ extern "C" {
  
 typedef OS_SEM    sys_sem_t;
 typedef OS_MUTEX  sys_mutex_t;
+
+/* 邮箱环形缓冲区的最大长度，sys_mbox_new()的size不能超过这个值 */
+#ifndef SYS_MBOX_SIZE_MAX
+#define SYS_MBOX_SIZE_MAX 8
+#endif
+
+/* SYS_ARCH_PROTECT的实现：1为uC-CPU临界区(BASEPRI)，0为uCOS互斥量 */
+#ifndef SYS_ARCH_PROT_CRITICAL
+#define SYS_ARCH_PROT_CRITICAL 1
+#endif
+
+/* sys_thread_new()的任务槽表，每项SYS_THREAD_SLOT(任务名, 栈大小(单位CPU_STK))是一个TCB和一段任务栈。
+ * 任务名为NULL的是通用槽，给表中没有列出名字的任务使用。默认是tcpip_thread加一个应用任务，
+ * SYS_THREAD_SECTION用于把TCB和任务栈放到分散加载文件指定的区域 */
+#ifndef SYS_THREAD_SLOTS
+#define SYS_THREAD_SLOTS \
+  SYS_THREAD_SLOT(TCPIP_THREAD_NAME, TCPIP_THREAD_STACKSIZE) \
+  SYS_THREAD_SLOT(NULL, DEFAULT_THREAD_STACKSIZE)
+#endif
+#ifndef SYS_THREAD_SECTION
+#define SYS_THREAD_SECTION
+#endif
+
+/* sys_now_us()使用的32位定时器，不能和动态节拍(TIM5)等其他功能冲突 */
+#ifndef SYS_NOW_US_TIM
+#define SYS_NOW_US_TIM              TIM2
+#define SYS_NOW_US_TIM_CLK_ENABLE() __HAL_RCC_TIM2_CLK_ENABLE()
+#endif
+
+/* 邮箱可以分成两级：msg[0, size)为普通队列，msg[size, size + hi_size)为高优先级队列，
+ * 取消息时先取高优先级队列。sys_mbox_new()创建的邮箱hi_size为0 */
 typedef struct
 {
-  OS_Q    msg_queen;
-  OS_SEM  msg_sem;
+  void   *msg[SYS_MBOX_SIZE_MAX];
+  u16_t   size;
+  u16_t   head;
+  u16_t   count;
+  u16_t   hi_size;
+  u16_t   hi_head;
+  u16_t   hi_count;
+  u16_t   count_max;      //普通队列的最大深度
+  u16_t   hi_count_max;   //高优先级队列的最大深度
+  u8_t    rx_waiters;     //邮箱空时等待取消息的任务数
+  u8_t    tx_waiters;     //邮箱满时等待发消息的任务数
+  OS_SEM  wait_sem;
 } sys_mbox_t;
 typedef void      sys_thread_t;
 
+/* SYS_ARCH_OBJ_DBG为1时统计信号量、邮箱的创建和删除次数，以及对无效(未创建或已删除)对象的操作次数，
+ * 创建和删除次数之差就是当前存在的对象数，用来检查netconn反复创建删除时有没有泄漏 */
+#ifndef SYS_ARCH_OBJ_DBG
+#define SYS_ARCH_OBJ_DBG 0
+#endif
+
+#if SYS_ARCH_OBJ_DBG
+typedef struct
+{
+  u32_t sem_new;
+  u32_t sem_free;
+  u32_t mbox_new;
+  u32_t mbox_free;
+  u32_t post_invalid;     //向无效的信号量、邮箱发送的次数
+  u32_t free_invalid;     //删除无效的信号量、邮箱的次数
+} sys_arch_obj_dbg_t;
+
+extern sys_arch_obj_dbg_t SysArchObjDbg;
+#endif /* SYS_ARCH_OBJ_DBG */
+
+#if LWIP_NETCONN_SEM_PER_THREAD
+sys_sem_t *sys_arch_netconn_sem_get(void);
+void sys_arch_netconn_sem_alloc(void);
+void sys_arch_netconn_sem_free(void);
+#define LWIP_NETCONN_THREAD_SEM_GET()   sys_arch_netconn_sem_get()
+#define LWIP_NETCONN_THREAD_SEM_ALLOC() sys_arch_netconn_sem_alloc()
+#define LWIP_NETCONN_THREAD_SEM_FREE()  sys_arch_netconn_sem_free()
+#endif /* LWIP_NETCONN_SEM_PER_THREAD */
+
+/* 两级邮箱，供tcpip_thread的收包快速通道(LWIP_TCPIP_MBOX_HI)使用 */
+err_t sys_mbox_new_prio(sys_mbox_t *mbox, int size, int hi_size);
+err_t sys_mbox_trypost_prio(sys_mbox_t *mbox, void *msg);
+void sys_mbox_get_depth(sys_mbox_t *mbox, u16_t *count, u16_t *hi_count, u16_t *count_max, u16_t *hi_count_max);
+
+/* 微秒时钟，用于TCP的RTT测量和应用的时延测量 */
+u32_t sys_now_us(void);
+
+#if OS_CFG_STAT_TASK_STK_CHK_EN > 0u
+err_t sys_arch_thread_stk_chk(u8_t idx, const char **name, CPU_STK_SIZE *used, CPU_STK_SIZE *free);
+#endif
+
 #define SYS_MBOX_NULL   (sys_mbox_t *)NULL
 #define SYS_SEM_NULL    (sys_sem_t *)NULL
 #define SYS_MUTEX_NULL  (sys_mutex_t *)NULL
@@ -255,9 +255,55 @@ lwip_standard_chksum(const void *dataptr, int len)
 }
 #endif
 
+#if LWIP_CHECKSUM_ON_RX_COPY
+/**
+ * Sum of one received pbuf's data, reusing the sum the netif driver recorded
+ * while copying the frame (see pbuf_set_rx_chksum()). The data must still end
+ * where it ended then; the headers removed in front of it since are summed
+ * again and subtracted. Otherwise the data is summed with LWIP_CHKSUM().
+ *
+ * @param q the pbuf (not chain) to sum
+ * @return the same as LWIP_CHKSUM(q->payload, q->len)
+ */
+static u16_t
+inet_chksum_rx_part(const struct pbuf *q)
+{
+  const u8_t *start;
+  u16_t skip;
+  u32_t acc;
+
+  if ((q->flags & PBUF_FLAG_RX_CHKSUM) != 0) {
+    start = (const u8_t *)q->rx_chksum_start;
+    if (((const u8_t *)q->payload >= start) &&
+        ((const u8_t *)q->payload + q->len == start + q->rx_chksum_len)) {
+      skip = (u16_t)((const u8_t *)q->payload - start);
+      if (skip == 0) {
+        return q->rx_chksum;
+      }
+      /* only cheaper as long as the removed headers are shorter than the data */
+      if (skip < q->len) {
+        /* one's complement subtraction: add the complement of the headers' sum */
+        acc = (u32_t)q->rx_chksum + (u16_t)~(unsigned int)LWIP_CHKSUM(start, skip);
+        acc = FOLD_U32T(acc);
+        acc = FOLD_U32T(acc);
+        /* the recorded sum was aligned to start, swap if an odd number of bytes was removed */
+        if ((skip & 1) != 0) {
+          acc = SWAP_BYTES_IN_WORD(acc);
+        }
+        return (u16_t)acc;
+      }
+    }
+  }
+  return LWIP_CHKSUM(q->payload, q->len);
+}
+#define INET_CHKSUM_PART(q, rx) ((rx) ? inet_chksum_rx_part(q) : LWIP_CHKSUM((q)->payload, (q)->len))
+#else /* LWIP_CHECKSUM_ON_RX_COPY */
+#define INET_CHKSUM_PART(q, rx) ((void)(rx), LWIP_CHKSUM((q)->payload, (q)->len))
+#endif /* LWIP_CHECKSUM_ON_RX_COPY */
+
 /** Parts of the pseudo checksum which are common to IPv4 and IPv6 */
 static u16_t
-inet_cksum_pseudo_base(struct pbuf *p, u8_t proto, u16_t proto_len, u32_t acc)
+inet_cksum_pseudo_base(struct pbuf *p, u8_t proto, u16_t proto_len, u32_t acc, u8_t rx)
 {
   struct pbuf *q;
   int swapped = 0;
@@ -266,7 +312,7 @@ inet_cksum_pseudo_base(struct pbuf *p, u8_t proto, u16_t proto_len, u32_t acc)
   for (q = p; q != NULL; q = q->next) {
     LWIP_DEBUGF(INET_DEBUG, ("inet_chksum_pseudo(): checksumming pbuf %p (has next %p) \n",
                              (void *)q, (void *)q->next));
-    acc += LWIP_CHKSUM(q->payload, q->len);
+    acc += INET_CHKSUM_PART(q, rx);
     /*LWIP_DEBUGF(INET_DEBUG, ("inet_chksum_pseudo(): unwrapped lwip_chksum()=%"X32_F" \n", acc));*/
     /* just executing this next line is probably faster that the if statement needed
        to check whether we really need to execute it, and does no harm */
@@ -294,6 +340,27 @@ inet_cksum_pseudo_base(struct pbuf *p, u8_t proto, u16_t proto_len, u32_t acc)
 }
 
 #if LWIP_IPV4
+/** inet_chksum_pseudo() with the choice to reuse checksums recorded for received pbufs */
+static u16_t
+inet_chksum_pseudo_impl(struct pbuf *p, u8_t proto, u16_t proto_len,
+                        const ip4_addr_t *src, const ip4_addr_t *dest, u8_t rx)
+{
+  u32_t acc;
+  u32_t addr;
+
+  addr = ip4_addr_get_u32(src);
+  acc = (addr & 0xffffUL);
+  acc = (u32_t)(acc + ((addr >> 16) & 0xffffUL));
+  addr = ip4_addr_get_u32(dest);
+  acc = (u32_t)(acc + (addr & 0xffffUL));
+  acc = (u32_t)(acc + ((addr >> 16) & 0xffffUL));
+  /* fold down to 16 bits */
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+
+  return inet_cksum_pseudo_base(p, proto, proto_len, acc, rx);
+}
+
 /* inet_chksum_pseudo:
  *
  * Calculates the IPv4 pseudo Internet checksum used by TCP and UDP for a pbuf chain.
@@ -310,24 +377,35 @@ u16_t
 inet_chksum_pseudo(struct pbuf *p, u8_t proto, u16_t proto_len,
                    const ip4_addr_t *src, const ip4_addr_t *dest)
 {
-  u32_t acc;
+  return inet_chksum_pseudo_impl(p, proto, proto_len, src, dest, 0);
+}
+#endif /* LWIP_IPV4 */
+
+#if LWIP_IPV6
+/** ip6_chksum_pseudo() with the choice to reuse checksums recorded for received pbufs */
+static u16_t
+ip6_chksum_pseudo_impl(struct pbuf *p, u8_t proto, u16_t proto_len,
+                       const ip6_addr_t *src, const ip6_addr_t *dest, u8_t rx)
+{
+  u32_t acc = 0;
   u32_t addr;
+  u8_t addr_part;
 
-  addr = ip4_addr_get_u32(src);
-  acc = (addr & 0xffffUL);
-  acc = (u32_t)(acc + ((addr >> 16) & 0xffffUL));
-  addr = ip4_addr_get_u32(dest);
-  acc = (u32_t)(acc + (addr & 0xffffUL));
-  acc = (u32_t)(acc + ((addr >> 16) & 0xffffUL));
+  for (addr_part = 0; addr_part < 4; addr_part++) {
+    addr = src->addr[addr_part];
+    acc = (u32_t)(acc + (addr & 0xffffUL));
+    acc = (u32_t)(acc + ((addr >> 16) & 0xffffUL));
+    addr = dest->addr[addr_part];
+    acc = (u32_t)(acc + (addr & 0xffffUL));
+    acc = (u32_t)(acc + ((addr >> 16) & 0xffffUL));
+  }
   /* fold down to 16 bits */
   acc = FOLD_U32T(acc);
   acc = FOLD_U32T(acc);
 
-  return inet_cksum_pseudo_base(p, proto, proto_len, acc);
+  return inet_cksum_pseudo_base(p, proto, proto_len, acc, rx);
 }
-#endif /* LWIP_IPV4 */
 
-#if LWIP_IPV6
 /**
  * Calculates the checksum with IPv6 pseudo header used by TCP and UDP for a pbuf chain.
  * IPv6 addresses are expected to be in network byte order.
@@ -343,23 +421,7 @@ u16_t
 ip6_chksum_pseudo(struct pbuf *p, u8_t proto, u16_t proto_len,
                   const ip6_addr_t *src, const ip6_addr_t *dest)
 {
-  u32_t acc = 0;
-  u32_t addr;
-  u8_t addr_part;
-
-  for (addr_part = 0; addr_part < 4; addr_part++) {
-    addr = src->addr[addr_part];
-    acc = (u32_t)(acc + (addr & 0xffffUL));
-    acc = (u32_t)(acc + ((addr >> 16) & 0xffffUL));
-    addr = dest->addr[addr_part];
-    acc = (u32_t)(acc + (addr & 0xffffUL));
-    acc = (u32_t)(acc + ((addr >> 16) & 0xffffUL));
-  }
-  /* fold down to 16 bits */
-  acc = FOLD_U32T(acc);
-  acc = FOLD_U32T(acc);
-
-  return inet_cksum_pseudo_base(p, proto, proto_len, acc);
+  return ip6_chksum_pseudo_impl(p, proto, proto_len, src, dest, 0);
 }
 #endif /* LWIP_IPV6 */
 
@@ -394,6 +456,40 @@ ip_chksum_pseudo(struct pbuf *p, u8_t proto, u16_t proto_len,
 #endif /* LWIP_IPV4 */
 }
 
+#if LWIP_CHECKSUM_ON_RX_COPY
+/* ip_chksum_pseudo_rx:
+ *
+ * Same as ip_chksum_pseudo(), for verifying the checksum of a received packet:
+ * reuses the checksums recorded by the netif driver with pbuf_set_rx_chksum().
+ * Only to be called before anything has written into the packet.
+ *
+ * @param p chain of pbufs over that a checksum should be calculated (ip data part)
+ * @param src source ip address (used for checksum of pseudo header)
+ * @param dst destination ip address (used for checksum of pseudo header)
+ * @param proto ip protocol (used for checksum of pseudo header)
+ * @param proto_len length of the ip data part (used for checksum of pseudo header)
+ * @return checksum (as u16_t), 0 if the packet is intact
+ */
+u16_t
+ip_chksum_pseudo_rx(struct pbuf *p, u8_t proto, u16_t proto_len,
+                    const ip_addr_t *src, const ip_addr_t *dest)
+{
+#if LWIP_IPV6
+  if (IP_IS_V6(dest)) {
+    return ip6_chksum_pseudo_impl(p, proto, proto_len, ip_2_ip6(src), ip_2_ip6(dest), 1);
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4 && LWIP_IPV6
+  else
+#endif /* LWIP_IPV4 && LWIP_IPV6 */
+#if LWIP_IPV4
+  {
+    return inet_chksum_pseudo_impl(p, proto, proto_len, ip_2_ip4(src), ip_2_ip4(dest), 1);
+  }
+#endif /* LWIP_IPV4 */
+}
+#endif /* LWIP_CHECKSUM_ON_RX_COPY */
+
 /** Parts of the pseudo checksum which are common to IPv4 and IPv6 */
 static u16_t
 inet_cksum_pseudo_partial_base(struct pbuf *p, u8_t proto, u16_t proto_len,
@@ -557,15 +653,9 @@ inet_chksum(const void *dataptr, u16_t len)
   return (u16_t)~(unsigned int)LWIP_CHKSUM(dataptr, len);
 }
 
-/**
- * Calculate a checksum over a chain of pbufs (without pseudo-header, much like
- * inet_chksum only pbufs are used).
- *
- * @param p pbuf chain over that the checksum should be calculated
- * @return checksum (as u16_t) to be saved directly in the protocol header
- */
-u16_t
-inet_chksum_pbuf(struct pbuf *p)
+/** inet_chksum_pbuf() with the choice to reuse checksums recorded for received pbufs */
+static u16_t
+inet_chksum_pbuf_impl(struct pbuf *p, u8_t rx)
 {
   u32_t acc;
   struct pbuf *q;
@@ -573,7 +663,7 @@ inet_chksum_pbuf(struct pbuf *p)
 
   acc = 0;
   for (q = p; q != NULL; q = q->next) {
-    acc += LWIP_CHKSUM(q->payload, q->len);
+    acc += INET_CHKSUM_PART(q, rx);
     acc = FOLD_U32T(acc);
     if (q->len % 2 != 0) {
       swapped = !swapped;
@@ -587,6 +677,35 @@ inet_chksum_pbuf(struct pbuf *p)
   return (u16_t)~(acc & 0xffffUL);
 }
 
+/**
+ * Calculate a checksum over a chain of pbufs (without pseudo-header, much like
+ * inet_chksum only pbufs are used).
+ *
+ * @param p pbuf chain over that the checksum should be calculated
+ * @return checksum (as u16_t) to be saved directly in the protocol header
+ */
+u16_t
+inet_chksum_pbuf(struct pbuf *p)
+{
+  return inet_chksum_pbuf_impl(p, 0);
+}
+
+#if LWIP_CHECKSUM_ON_RX_COPY
+/**
+ * Same as inet_chksum_pbuf(), for verifying the checksum of a received packet:
+ * reuses the checksums recorded by the netif driver with pbuf_set_rx_chksum().
+ * Only to be called before anything has written into the packet.
+ *
+ * @param p pbuf chain over that the checksum should be calculated
+ * @return checksum (as u16_t), 0 if the packet is intact
+ */
+u16_t
+inet_chksum_pbuf_rx(struct pbuf *p)
+{
+  return inet_chksum_pbuf_impl(p, 1);
+}
+#endif /* LWIP_CHECKSUM_ON_RX_COPY */
+
 /* These are some implementations for LWIP_CHKSUM_COPY, which copies data
  * like MEMCPY but generates a checksum at the same time. Since this is a
  * performance-sensitive function, you might want to create your own version
@@ -99,6 +99,10 @@ struct etharp_entry {
   struct netif *netif;
   struct eth_addr ethaddr;
   u16_t ctime;
+#if ETHARP_TABLE_HASH
+  /** etharp_use_ctr when the entry was last found for an address */
+  u32_t used;
+#endif /* ETHARP_TABLE_HASH */
   u8_t state;
 };
 
@@ -129,6 +133,42 @@ static netif_addr_idx_t etharp_cached_entry;
 #error "ARP_TABLE_SIZE must fit in an s16_t, you have to reduce it in your lwipopts.h"
 #endif
 
+#if ETHARP_TABLE_HASH
+#if (ETHARP_TABLE_HASH_WAYS < 1) || ((ARP_TABLE_SIZE % ETHARP_TABLE_HASH_WAYS) != 0)
+#error "ARP_TABLE_SIZE must be a multiple of ETHARP_TABLE_HASH_WAYS, adjust your lwipopts.h"
+#endif
+/** number of sets the ARP table is split into */
+#define ETHARP_TABLE_SETS  (ARP_TABLE_SIZE / ETHARP_TABLE_HASH_WAYS)
+
+/**
+ * Get the index of the first entry of the set an IP address is cached in.
+ * A multiplicative hash is used so that addresses differing only in the
+ * host part (the last bytes in network order) spread over all sets.
+ *
+ * @param ipaddr IP address to hash
+ * @return index of the first of the ETHARP_TABLE_HASH_WAYS entries of the set
+ */
+static s16_t
+etharp_set_first(const ip4_addr_t *ipaddr)
+{
+  u32_t h = ip4_addr_get_u32(ipaddr) * 2654435761UL;
+  return (s16_t)(((h >> 16) % ETHARP_TABLE_SETS) * ETHARP_TABLE_HASH_WAYS);
+}
+
+/** incremented on every use of an entry, the stamps order the entries by last use */
+static u32_t etharp_use_ctr;
+/** record a use of entry i (lookup hit in etharp_output or etharp_find_entry, or creation) */
+#define ETHARP_ENTRY_USED(i)  (arp_table[i].used = ++etharp_use_ctr)
+/** recycle the least recently used entry of a set (the difference is wrap-around safe) */
+#define ETHARP_ENTRY_AGE(i)   (etharp_use_ctr - arp_table[i].used)
+typedef u32_t etharp_age_t;
+#else /* ETHARP_TABLE_HASH */
+#define ETHARP_ENTRY_USED(i)
+/** recycle the entry that was least recently created or refreshed */
+#define ETHARP_ENTRY_AGE(i)   (arp_table[i].ctime)
+typedef u16_t etharp_age_t;
+#endif /* ETHARP_TABLE_HASH */
+
 
 static err_t etharp_request_dst(struct netif *netif, const ip4_addr_t *ipaddr, const struct eth_addr *hw_dst_addr);
 static err_t etharp_raw(struct netif *netif,
@@ -258,13 +298,24 @@ etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif *netif)
   s16_t old_pending = ARP_TABLE_SIZE, old_stable = ARP_TABLE_SIZE;
   s16_t empty = ARP_TABLE_SIZE;
   s16_t i = 0;
+  /* range of entries searched */
+  s16_t first = 0, last = ARP_TABLE_SIZE;
   /* oldest entry with packets on queue */
   s16_t old_queue = ARP_TABLE_SIZE;
   /* its age */
-  u16_t age_queue = 0, age_pending = 0, age_stable = 0;
+  etharp_age_t age_queue = 0, age_pending = 0, age_stable = 0;
 
   LWIP_UNUSED_ARG(netif);
 
+#if ETHARP_TABLE_HASH
+  /* an address can only be cached in its own set: search (and recycle) there,
+     a new entry without address may use any set */
+  if (ipaddr != NULL) {
+    first = etharp_set_first(ipaddr);
+    last = (s16_t)(first + ETHARP_TABLE_HASH_WAYS);
+  }
+#endif /* ETHARP_TABLE_HASH */
+
   /**
    * a) do a search through the cache, remember candidates
    * b) select candidate entry
@@ -280,7 +331,7 @@ etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif *netif)
    *    until 5 matches, or all entries are searched for.
    */
 
-  for (i = 0; i < ARP_TABLE_SIZE; ++i) {
+  for (i = first; i < last; ++i) {
     u8_t state = arp_table[i].state;
     /* no empty entry found yet and now we do find one? */
     if ((empty == ARP_TABLE_SIZE) && (state == ETHARP_STATE_EMPTY)) {
@@ -298,22 +349,23 @@ etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif *netif)
          ) {
         LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_find_entry: found matching entry %d\n", (int)i));
         /* found exact IP address match, simply bail out */
+        ETHARP_ENTRY_USED(i);
         return i;
       }
       /* pending entry? */
       if (state == ETHARP_STATE_PENDING) {
         /* pending with queued packets? */
         if (arp_table[i].q != NULL) {
-          if (arp_table[i].ctime >= age_queue) {
+          if (ETHARP_ENTRY_AGE(i) >= age_queue) {
             old_queue = i;
-            age_queue = arp_table[i].ctime;
+            age_queue = ETHARP_ENTRY_AGE(i);
           }
         } else
           /* pending without queued packets? */
         {
-          if (arp_table[i].ctime >= age_pending) {
+          if (ETHARP_ENTRY_AGE(i) >= age_pending) {
             old_pending = i;
-            age_pending = arp_table[i].ctime;
+            age_pending = ETHARP_ENTRY_AGE(i);
           }
         }
         /* stable entry? */
@@ -324,9 +376,9 @@ etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif *netif)
 #endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
         {
           /* remember entry with oldest stable entry in oldest, its age in maxtime */
-          if (arp_table[i].ctime >= age_stable) {
+          if (ETHARP_ENTRY_AGE(i) >= age_stable) {
             old_stable = i;
-            age_stable = arp_table[i].ctime;
+            age_stable = ETHARP_ENTRY_AGE(i);
           }
         }
       }
@@ -394,6 +446,7 @@ etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif *netif)
     ip4_addr_copy(arp_table[i].ipaddr, *ipaddr);
   }
   arp_table[i].ctime = 0;
+  ETHARP_ENTRY_USED(i);
 #if ETHARP_TABLE_MATCH_NETIF
   arp_table[i].netif = netif;
 #endif /* ETHARP_TABLE_MATCH_NETIF */
@@ -820,6 +873,9 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
     /* unicast destination IP address? */
   } else {
     netif_addr_idx_t i;
+#if ETHARP_TABLE_HASH
+    netif_addr_idx_t last;
+#endif /* ETHARP_TABLE_HASH */
     /* outside local network? if so, this can neither be a global broadcast nor
        a subnet broadcast. */
     if (!ip4_addr_netcmp(ipaddr, netif_ip4_addr(netif), netif_ip4_netmask(netif)) &&
@@ -865,6 +921,7 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
             (ip4_addr_cmp(dst_addr, &arp_table[etharp_cached_entry].ipaddr))) {
           /* the per-pcb-cached entry is stable and the right one! */
           ETHARP_STATS_INC(etharp.cachehit);
+          ETHARP_ENTRY_USED(etharp_cached_entry);
           return etharp_output_to_arp_index(netif, q, etharp_cached_entry);
         }
 #if LWIP_NETIF_HWADDRHINT
@@ -874,7 +931,12 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
 
     /* find stable entry: do this here since this is a critical path for
        throughput and etharp_find_entry() is kind of slow */
+#if ETHARP_TABLE_HASH
+    i = (netif_addr_idx_t)etharp_set_first(dst_addr);
+    for (last = (netif_addr_idx_t)(i + ETHARP_TABLE_HASH_WAYS); i < last; i++) {
+#else /* ETHARP_TABLE_HASH */
     for (i = 0; i < ARP_TABLE_SIZE; i++) {
+#endif /* ETHARP_TABLE_HASH */
       if ((arp_table[i].state >= ETHARP_STATE_STABLE) &&
 #if ETHARP_TABLE_MATCH_NETIF
           (arp_table[i].netif == netif) &&
@@ -882,6 +944,7 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
           (ip4_addr_cmp(dst_addr, &arp_table[i].ipaddr))) {
         /* found an existing, stable entry */
         ETHARP_SET_ADDRHINT(netif, i);
+        ETHARP_ENTRY_USED(i);
         return etharp_output_to_arp_index(netif, q, i);
       }
     }
@@ -143,8 +143,8 @@ icmp_input(struct pbuf *p, struct netif *inp)
         goto lenerr;
       }
 #if CHECKSUM_CHECK_ICMP
-      IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_ICMP) {
-        if (inet_chksum_pbuf(p) != 0) {
+      IF__NETIF_CHECKSUM_CHECK_RX(inp, p, NETIF_CHECKSUM_CHECK_ICMP) {
+        if (inet_chksum_pbuf_rx(p) != 0) {
           LWIP_DEBUGF(ICMP_DEBUG, ("icmp_input: checksum failed for received ICMP echo\n"));
           pbuf_free(p);
           ICMP_STATS_INC(icmp.chkerr);
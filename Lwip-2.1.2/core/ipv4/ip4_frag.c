@@ -514,6 +514,12 @@ ip4_reass(struct pbuf *p)
   IPFRAG_STATS_INC(ip_frag.recv);
   MIB2_STATS_INC(mib2.ipreasmreqds);
 
+  /* the reassembly helper and the copied-back header overwrite the fragment's
+     header, so checksums recorded by the netif driver are no longer valid */
+  pbuf_clear_rx_chksum(p);
+  /* hardware does not verify fragments, the reassembled datagram is checked in software */
+  p->flags &= (u8_t)~PBUF_FLAG_RX_HWCHKSUM;
+
   fraghdr = (struct ip_hdr *)p->payload;
 
   if (IPH_HL_BYTES(fraghdr) != IP_HLEN) {
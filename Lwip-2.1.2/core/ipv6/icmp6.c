@@ -100,7 +100,7 @@ icmp6_input(struct pbuf *p, struct netif *inp)
   icmp6hdr = (struct icmp6_hdr *)p->payload;
 
 #if CHECKSUM_CHECK_ICMP6
-  IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_ICMP6) {
+  IF__NETIF_CHECKSUM_CHECK_RX(inp, p, NETIF_CHECKSUM_CHECK_ICMP6) {
     if (ip6_chksum_pseudo(p, IP6_NEXTH_ICMP6, p->tot_len, ip6_current_src_addr(),
                           ip6_current_dest_addr()) != 0) {
       /* Checksum failed */
@@ -282,6 +282,12 @@ ip6_reass(struct pbuf *p)
 
   IP6_FRAG_STATS_INC(ip6_frag.recv);
 
+  /* the reassembly helper overwrites the fragment's header, so checksums
+     recorded by the netif driver are no longer valid */
+  pbuf_clear_rx_chksum(p);
+  /* hardware does not verify fragments, the reassembled datagram is checked in software */
+  p->flags &= (u8_t)~PBUF_FLAG_RX_HWCHKSUM;
+
   /* ip6_frag_hdr must be in the first pbuf, not chained. Checked by caller. */
   LWIP_ASSERT("IPv6 fragment header does not fit in first pbuf",
     p->len >= sizeof(struct ip6_frag_hdr));
@@ -76,6 +76,8 @@
 #include "lwip/mld6.h"
 
 #define LWIP_MEMPOOL(name,num,size,desc) LWIP_MEMPOOL_DECLARE(name,num,size,desc)
+/* pbuf pools carry frame data, place them in DMA-capable memory */
+#define LWIP_PBUF_MEMPOOL(name,num,payload,desc) LWIP_MEMPOOL_DECLARE_DMA(name,num,(LWIP_MEM_ALIGN_SIZE(sizeof(struct pbuf)) + LWIP_MEM_ALIGN_SIZE(payload)),desc)
 #include "lwip/priv/memp_std.h"
 
 const struct memp_desc *const memp_pools[MEMP_MAX] = {
@@ -445,3 +447,119 @@ memp_free(memp_t type, void *mem)
   }
 #endif
 }
+
+/**
+ * Start collecting elements of a pool to be freed together.
+ *
+ * @param batch the batch to initialize
+ * @param type the pool all elements added to the batch belong to
+ */
+void
+memp_batch_init(struct memp_batch *batch, memp_t type)
+{
+  batch->first = NULL;
+  batch->last = NULL;
+  batch->count = 0;
+  batch->type = type;
+}
+
+/**
+ * Add an element to a batch. The element must not be used any more, it is
+ * linked into the batch but only returned to the pool by memp_batch_free().
+ *
+ * @param batch the batch to add the element to
+ * @param mem the memp element to free
+ */
+void
+memp_batch_add(struct memp_batch *batch, void *mem)
+{
+#if !MEMP_MEM_MALLOC
+  struct memp *memp;
+#endif /* !MEMP_MEM_MALLOC */
+
+  LWIP_ERROR("memp_batch_add: type < MEMP_MAX", (batch->type < MEMP_MAX), return;);
+
+  if (mem == NULL) {
+    return;
+  }
+
+#if MEMP_MEM_MALLOC
+  /* elements live on the heap, nothing to gain from batching */
+  memp_free(batch->type, mem);
+#else /* MEMP_MEM_MALLOC */
+  LWIP_ASSERT("memp_batch_add: mem properly aligned",
+              ((mem_ptr_t)mem % MEM_ALIGNMENT) == 0);
+
+  /* cast through void* to get rid of alignment warnings */
+  memp = (struct memp *)(void *)((u8_t *)mem - MEMP_SIZE);
+
+#if MEMP_OVERFLOW_CHECK == 1
+  memp_overflow_check_element(memp, memp_pools[batch->type]);
+#endif /* MEMP_OVERFLOW_CHECK */
+
+  /* the element is owned by the caller now, no protection needed to link it */
+  memp->next = batch->first;
+  batch->first = memp;
+  if (batch->last == NULL) {
+    batch->last = memp;
+  }
+  batch->count++;
+#endif /* MEMP_MEM_MALLOC */
+}
+
+/**
+ * Put all elements of a batch back into their pool at once and reset the
+ * batch, so it can be reused.
+ *
+ * @param batch the batch to free
+ */
+void
+memp_batch_free(struct memp_batch *batch)
+{
+#if !MEMP_MEM_MALLOC
+  const struct memp_desc *desc;
+#ifdef LWIP_HOOK_MEMP_AVAILABLE
+  struct memp *old_first;
+#endif
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  LWIP_ERROR("memp_batch_free: type < MEMP_MAX", (batch->type < MEMP_MAX), return;);
+
+  if (batch->count == 0) {
+    return;
+  }
+
+#if MEMP_OVERFLOW_CHECK >= 2
+  memp_overflow_check_all();
+#endif /* MEMP_OVERFLOW_CHECK >= 2 */
+
+  desc = memp_pools[batch->type];
+
+  SYS_ARCH_PROTECT(old_level);
+
+#ifdef LWIP_HOOK_MEMP_AVAILABLE
+  old_first = *desc->tab;
+#endif
+
+#if MEMP_STATS
+  desc->stats->used = (mem_size_t)(desc->stats->used - batch->count);
+#endif
+
+  batch->last->next = *desc->tab;
+  *desc->tab = batch->first;
+
+#if MEMP_SANITY_CHECK
+  LWIP_ASSERT("memp sanity", memp_sanity(desc));
+#endif /* MEMP_SANITY_CHECK */
+
+  SYS_ARCH_UNPROTECT(old_level);
+
+#ifdef LWIP_HOOK_MEMP_AVAILABLE
+  if (old_first == NULL) {
+    LWIP_HOOK_MEMP_AVAILABLE(batch->type);
+  }
+#endif
+#endif /* !MEMP_MEM_MALLOC */
+
+  memp_batch_init(batch, batch->type);
+}
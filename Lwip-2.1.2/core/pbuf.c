@@ -724,9 +724,54 @@ pbuf_free_header(struct pbuf *q, u16_t size)
 u8_t
 pbuf_free(struct pbuf *p)
 {
-  u8_t alloc_src;
+  struct pbuf_batch batch;
+  u8_t count;
+
+  PERF_START;
+
+  pbuf_batch_init(&batch);
+  count = pbuf_free_deferred(&batch, p);
+  pbuf_batch_flush(&batch);
+
+  PERF_STOP("pbuf_free");
+  /* return number of de-allocated pbufs */
+  return count;
+}
+
+/**
+ * @ingroup pbuf
+ * Start collecting pbufs for pbuf_batch_flush().
+ *
+ * @param batch the batch to initialize
+ */
+void
+pbuf_batch_init(struct pbuf_batch *batch)
+{
+  batch->list = NULL;
+}
+
+/**
+ * @ingroup pbuf
+ * Same as pbuf_free(), but pbufs whose reference count drops to zero are
+ * only collected in batch. They are deallocated by pbuf_batch_flush(),
+ * which returns all PBUF_POOL (and PBUF_ROM/REF) pbufs of the batch to
+ * their pool with one SYS_ARCH_PROTECT section. The reference counts of
+ * the whole chain are decremented inside one protect section as well.
+ *
+ * @param batch the batch collecting the pbufs to deallocate
+ * @param p The pbuf (chain) to be dereferenced.
+ *
+ * @return the number of pbufs that will be de-allocated
+ * from the head of the chain.
+ */
+u8_t
+pbuf_free_deferred(struct pbuf_batch *batch, struct pbuf *p)
+{
   struct pbuf *q;
+  struct pbuf *last;
+  LWIP_PBUF_REF_T ref;
   u8_t count;
+  SYS_ARCH_DECL_PROTECT(old_level);
 
   if (p == NULL) {
     LWIP_ASSERT("p != NULL", p != NULL);
@@ -737,66 +782,93 @@ pbuf_free(struct pbuf *p)
   }
   LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_free(%p)\n", (void *)p));
 
-  PERF_START;
-
   count = 0;
-  /* de-allocate all consecutive pbufs from the head of the chain that
-   * obtain a zero reference count after decrementing*/
-  while (p != NULL) {
-    LWIP_PBUF_REF_T ref;
-    SYS_ARCH_DECL_PROTECT(old_level);
-    /* Since decrementing ref cannot be guaranteed to be a single machine operation
-     * we must protect it. We put the new ref into a local variable to prevent
-     * further protection. */
-    SYS_ARCH_PROTECT(old_level);
+  last = NULL;
+  ref = 0;
+  /* Since decrementing ref cannot be guaranteed to be a single machine operation
+   * we must protect it. All consecutive pbufs from the head of the chain that
+   * obtain a zero reference count are counted in one protected section. */
+  SYS_ARCH_PROTECT(old_level);
+  for (q = p; q != NULL; q = q->next) {
     /* all pbufs in a chain are referenced at least once */
-    LWIP_ASSERT("pbuf_free: p->ref > 0", p->ref > 0);
+    LWIP_ASSERT("pbuf_free: p->ref > 0", q->ref > 0);
     /* decrease reference count (number of pointers to pbuf) */
-    ref = --(p->ref);
-    SYS_ARCH_UNPROTECT(old_level);
-    /* this pbuf is no longer referenced to? */
-    if (ref == 0) {
-      /* remember next pbuf in chain for next iteration */
-      q = p->next;
-      LWIP_DEBUGF( PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_free: deallocating %p\n", (void *)p));
-      alloc_src = pbuf_get_allocsrc(p);
+    ref = --(q->ref);
+    if (ref != 0) {
+      /* this pbuf is still referenced to (and so the remaining pbufs in chain as well) */
+      break;
+    }
+    last = q;
+    count++;
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+
+  if (q != NULL) {
+    LWIP_DEBUGF( PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_free: %p has ref %"U16_F", ending here.\n", (void *)q, (u16_t)ref));
+  }
+
+  if (last != NULL) {
+    /* nobody else references p..last any more, move them to the batch */
+    last->next = batch->list;
+    batch->list = p;
+  }
+  return count;
+}
+
+/**
+ * @ingroup pbuf
+ * Deallocate all pbufs collected by pbuf_free_deferred() and reset the batch.
+ *
+ * @param batch the batch to flush
+ */
+void
+pbuf_batch_flush(struct pbuf_batch *batch)
+{
+  struct pbuf *p;
+  struct pbuf *q;
+  u8_t alloc_src;
+  struct memp_batch pool_batch;
+  struct memp_batch pbuf_batch;
+
+  memp_batch_init(&pool_batch, MEMP_PBUF_POOL);
+  memp_batch_init(&pbuf_batch, MEMP_PBUF);
+
+  p = batch->list;
+  batch->list = NULL;
+  while (p != NULL) {
+    /* remember next pbuf in the batch for next iteration */
+    q = p->next;
+    LWIP_DEBUGF( PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_free: deallocating %p\n", (void *)p));
+    alloc_src = pbuf_get_allocsrc(p);
 #if LWIP_SUPPORT_CUSTOM_PBUF
-      /* is this a custom pbuf? */
-      if ((p->flags & PBUF_FLAG_IS_CUSTOM) != 0) {
-        struct pbuf_custom *pc = (struct pbuf_custom *)p;
-        LWIP_ASSERT("pc->custom_free_function != NULL", pc->custom_free_function != NULL);
-        pc->custom_free_function(p);
-      } else
+    /* is this a custom pbuf? */
+    if ((p->flags & PBUF_FLAG_IS_CUSTOM) != 0) {
+      struct pbuf_custom *pc = (struct pbuf_custom *)p;
+      LWIP_ASSERT("pc->custom_free_function != NULL", pc->custom_free_function != NULL);
+      pc->custom_free_function(p);
+    } else
 #endif /* LWIP_SUPPORT_CUSTOM_PBUF */
-      {
-        /* is this a pbuf from the pool? */
-        if (alloc_src == PBUF_TYPE_ALLOC_SRC_MASK_STD_MEMP_PBUF_POOL) {
-          memp_free(MEMP_PBUF_POOL, p);
-          /* is this a ROM or RAM referencing pbuf? */
-        } else if (alloc_src == PBUF_TYPE_ALLOC_SRC_MASK_STD_MEMP_PBUF) {
-          memp_free(MEMP_PBUF, p);
-          /* type == PBUF_RAM */
-        } else if (alloc_src == PBUF_TYPE_ALLOC_SRC_MASK_STD_HEAP) {
-          mem_free(p);
-        } else {
-          /* @todo: support freeing other types */
-          LWIP_ASSERT("invalid pbuf type", 0);
-        }
+    {
+      /* is this a pbuf from the pool? */
+      if (alloc_src == PBUF_TYPE_ALLOC_SRC_MASK_STD_MEMP_PBUF_POOL) {
+        memp_batch_add(&pool_batch, p);
+        /* is this a ROM or RAM referencing pbuf? */
+      } else if (alloc_src == PBUF_TYPE_ALLOC_SRC_MASK_STD_MEMP_PBUF) {
+        memp_batch_add(&pbuf_batch, p);
+        /* type == PBUF_RAM */
+      } else if (alloc_src == PBUF_TYPE_ALLOC_SRC_MASK_STD_HEAP) {
+        mem_free(p);
+      } else {
+        /* @todo: support freeing other types */
+        LWIP_ASSERT("invalid pbuf type", 0);
       }
-      count++;
-      /* proceed to next pbuf */
-      p = q;
-      /* p->ref > 0, this pbuf is still referenced to */
-      /* (and so the remaining pbufs in chain as well) */
-    } else {
-      LWIP_DEBUGF( PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_free: %p has ref %"U16_F", ending here.\n", (void *)p, (u16_t)ref));
-      /* stop walking through the chain */
-      p = NULL;
     }
+    /* proceed to next pbuf */
+    p = q;
   }
-  PERF_STOP("pbuf_free");
-  /* return number of de-allocated pbufs */
-  return count;
+
+  memp_batch_free(&pool_batch);
+  memp_batch_free(&pbuf_batch);
 }
 
 /**
@@ -1358,6 +1430,44 @@ pbuf_fill_chksum(struct pbuf *p, u16_t start_offset, const void *dataptr,
 }
 #endif /* LWIP_CHECKSUM_ON_COPY */
 
+#if LWIP_CHECKSUM_ON_RX_COPY
+/**
+ * Record the checksum of a received pbuf's data, computed by the netif driver
+ * while copying the frame into it (e.g. with LWIP_CHKSUM_COPY). It covers
+ * p->len bytes from the current p->payload (not the rest of the chain).
+ * ip_chksum_pseudo_rx() and inet_chksum_pbuf_rx() reuse it as long as the data
+ * still ends where it ended here, summing only the headers removed in front.
+ *
+ * @param p the pbuf (not chain) the checksum was computed for
+ * @param chksum the sum as returned by LWIP_CHKSUM(p->payload, p->len)
+ */
+void
+pbuf_set_rx_chksum(struct pbuf *p, u16_t chksum)
+{
+  LWIP_ASSERT("p != NULL", p != NULL);
+  p->rx_chksum = chksum;
+  p->rx_chksum_len = p->len;
+  p->rx_chksum_start = p->payload;
+  p->flags |= PBUF_FLAG_RX_CHKSUM;
+}
+
+/**
+ * Forget the checksums recorded by pbuf_set_rx_chksum() for a pbuf chain.
+ * Must be called before anything writes into the covered data of a received
+ * packet that is checked later on (e.g. reassembly writing its helper data
+ * over fragment headers).
+ *
+ * @param p the pbuf chain
+ */
+void
+pbuf_clear_rx_chksum(struct pbuf *p)
+{
+  for (; p != NULL; p = p->next) {
+    p->flags &= (u8_t)~PBUF_FLAG_RX_CHKSUM;
+  }
+}
+#endif /* LWIP_CHECKSUM_ON_RX_COPY */
+
 /**
  * @ingroup pbuf
  * Get one byte from the specified position in a pbuf
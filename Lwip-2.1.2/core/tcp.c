@@ -184,6 +184,18 @@ struct tcp_pcb **const tcp_pcb_lists[] = {&tcp_listen_pcbs.pcbs, &tcp_bound_pcbs
 
 u8_t tcp_active_pcbs_changed;
 
+#if TCP_PCB_HASH
+#if ((TCP_PCB_HASH_SIZE & (TCP_PCB_HASH_SIZE - 1)) != 0) || ((TCP_LISTEN_HASH_SIZE & (TCP_LISTEN_HASH_SIZE - 1)) != 0)
+#error "TCP_PCB_HASH_SIZE and TCP_LISTEN_HASH_SIZE must be powers of 2"
+#endif
+/** Hash chains of tcp_active_pcbs, keyed by the 4-tuple */
+struct tcp_pcb *tcp_active_hash[TCP_PCB_HASH_SIZE];
+/** Hash chains of tcp_tw_pcbs, keyed by the 4-tuple */
+struct tcp_pcb *tcp_tw_hash[TCP_PCB_HASH_SIZE];
+/** Hash chains of tcp_listen_pcbs, keyed by the local port */
+union tcp_listen_pcbs_t tcp_listen_hash[TCP_LISTEN_HASH_SIZE];
+#endif /* TCP_PCB_HASH */
+
 /** Timer counter to handle calling slow-timer from tcp_tmr() */
 static u8_t tcp_timer;
 static u8_t tcp_timer_ctr;
@@ -1393,6 +1405,7 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_active_pcbs", tcp_active_pcbs == pcb);
         tcp_active_pcbs = pcb->next;
       }
+      TCP_PCB_HASH_RMV(&tcp_active_pcbs, pcb);
 
       if (pcb_reset) {
         tcp_rst(pcb, pcb->snd_nxt, pcb->rcv_nxt, &pcb->local_ip, &pcb->remote_ip,
@@ -1459,6 +1472,7 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_tw_pcbs", tcp_tw_pcbs == pcb);
         tcp_tw_pcbs = pcb->next;
       }
+      TCP_PCB_HASH_RMV(&tcp_tw_pcbs, pcb);
       pcb2 = pcb;
       pcb = pcb->next;
       tcp_free(pcb2);
@@ -2167,6 +2181,97 @@ tcp_pcb_purge(struct tcp_pcb *pcb)
   }
 }
 
+#if TCP_PCB_HASH
+/**
+ * Hash chain index of an active or TIME-WAIT pcb. The local address is left
+ * out: connections on the same ports rarely differ only in it, and lookups
+ * compare the full 4-tuple anyway.
+ *
+ * @param remote_ip remote address
+ * @param local_port local port (host byte order)
+ * @param remote_port remote port (host byte order)
+ * @return index into tcp_active_hash/tcp_tw_hash
+ */
+u16_t
+tcp_pcb_hash_idx(const ip_addr_t *remote_ip, u16_t local_port, u16_t remote_port)
+{
+  u32_t h = ((u32_t)local_port << 16) ^ remote_port;
+
+#if LWIP_IPV6
+  if (IP_IS_V6(remote_ip)) {
+    h ^= ip_2_ip6(remote_ip)->addr[3];
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4 && LWIP_IPV6
+  else
+#endif /* LWIP_IPV4 && LWIP_IPV6 */
+#if LWIP_IPV4
+  {
+    h ^= ip4_addr_get_u32(ip_2_ip4(remote_ip));
+  }
+#endif /* LWIP_IPV4 */
+  h ^= h >> 16;
+  h ^= h >> 8;
+  return (u16_t)(h & (TCP_PCB_HASH_SIZE - 1));
+}
+
+/** The hash chain a pcb on the given list belongs to (NULL for tcp_bound_pcbs) */
+static struct tcp_pcb **
+tcp_pcb_hash_chain(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  if (pcbs == &tcp_active_pcbs) {
+    return &tcp_active_hash[tcp_pcb_hash_idx(&pcb->remote_ip, pcb->local_port, pcb->remote_port)];
+  } else if (pcbs == &tcp_tw_pcbs) {
+    return &tcp_tw_hash[tcp_pcb_hash_idx(&pcb->remote_ip, pcb->local_port, pcb->remote_port)];
+  } else if (pcbs == &tcp_listen_pcbs.pcbs) {
+    return &tcp_listen_hash[TCP_LISTEN_HASH_IDX(pcb->local_port)].pcbs;
+  }
+  return NULL;
+}
+
+/**
+ * Called by TCP_REG: adds a pcb that has just been put on a list to the
+ * matching hash chain. Ports and addresses must not change until it is
+ * removed again.
+ *
+ * @param pcbs the list the pcb was put on
+ * @param pcb the pcb (a struct tcp_pcb_listen for tcp_listen_pcbs)
+ */
+void
+tcp_pcb_hash_add(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  struct tcp_pcb **chain = tcp_pcb_hash_chain(pcbs, pcb);
+
+  if (chain != NULL) {
+    pcb->hash_next = *chain;
+    *chain = pcb;
+  }
+}
+
+/**
+ * Called by TCP_RMV (and where tcp_slowtmr unlinks pcbs itself): removes a
+ * pcb from the hash chain of the list it was taken from.
+ *
+ * @param pcbs the list the pcb was removed from
+ * @param pcb the pcb (a struct tcp_pcb_listen for tcp_listen_pcbs)
+ */
+void
+tcp_pcb_hash_remove(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  struct tcp_pcb **chain = tcp_pcb_hash_chain(pcbs, pcb);
+
+  if (chain != NULL) {
+    for (; *chain != NULL; chain = &(*chain)->hash_next) {
+      if (*chain == pcb) {
+        *chain = pcb->hash_next;
+        break;
+      }
+    }
+    pcb->hash_next = NULL;
+  }
+}
+#endif /* TCP_PCB_HASH */
+
 /**
  * Purges the PCB and removes it from a PCB list. Any delayed ACKs are sent first.
  *
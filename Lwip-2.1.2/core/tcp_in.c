@@ -46,6 +46,9 @@
 #if LWIP_TCP /* don't build if not configured for use in lwipopts.h */
 
 #include "lwip/priv/tcp_priv.h"
+#if LWIP_TCP_RTT_US
+#include "lwip/sys.h"
+#endif
 #include "lwip/def.h"
 #include "lwip/ip_addr.h"
 #include "lwip/netif.h"
@@ -65,6 +68,13 @@
 #include LWIP_HOOK_FILENAME
 #endif
 
+#if TCP_PCB_HASH
+/* tcp_input() only walks the hash chain of the segment's 4-tuple (listen pcbs: local port) */
+#define TCP_PCB_LIST_NEXT(pcb) ((pcb)->hash_next)
+#else /* TCP_PCB_HASH */
+#define TCP_PCB_LIST_NEXT(pcb) ((pcb)->next)
+#endif /* TCP_PCB_HASH */
+
 /** Initial CWND calculation as defined RFC 2581 */
 #define LWIP_TCP_CALC_INITIAL_CWND(mss) ((tcpwnd_size_t)LWIP_MIN((4U * (mss)), LWIP_MAX((2U * (mss)), 4380U)))
 
@@ -118,7 +128,12 @@ void
 tcp_input(struct pbuf *p, struct netif *inp)
 {
   struct tcp_pcb *pcb, *prev;
+  struct tcp_pcb **pcbs;
   struct tcp_pcb_listen *lpcb;
+  union tcp_listen_pcbs_t *lpcbs;
+#if TCP_PCB_HASH
+  u16_t hash_idx;
+#endif /* TCP_PCB_HASH */
 #if SO_REUSE
   struct tcp_pcb *lpcb_prev = NULL;
   struct tcp_pcb_listen *lpcb_any = NULL;
@@ -157,10 +172,10 @@ tcp_input(struct pbuf *p, struct netif *inp)
   }
 
 #if CHECKSUM_CHECK_TCP
-  IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_TCP) {
+  IF__NETIF_CHECKSUM_CHECK_RX(inp, p, NETIF_CHECKSUM_CHECK_TCP) {
     /* Verify TCP checksum. */
-    u16_t chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
-                                    ip_current_src_addr(), ip_current_dest_addr());
+    u16_t chksum = ip_chksum_pseudo_rx(p, IP_PROTO_TCP, p->tot_len,
+                                       ip_current_src_addr(), ip_current_dest_addr());
     if (chksum != 0) {
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packet discarded due to failing checksum 0x%04"X16_F"\n",
                                     chksum));
@@ -246,8 +261,14 @@ tcp_input(struct pbuf *p, struct netif *inp)
   /* Demultiplex an incoming segment. First, we check if it is destined
      for an active connection. */
   prev = NULL;
-
-  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+#if TCP_PCB_HASH
+  hash_idx = tcp_pcb_hash_idx(ip_current_src_addr(), tcphdr->dest, tcphdr->src);
+  pcbs = &tcp_active_hash[hash_idx];
+#else /* TCP_PCB_HASH */
+  pcbs = &tcp_active_pcbs;
+#endif /* TCP_PCB_HASH */
+
+  for (pcb = *pcbs; pcb != NULL; pcb = TCP_PCB_LIST_NEXT(pcb)) {
     LWIP_ASSERT("tcp_input: active pcb->state != CLOSED", pcb->state != CLOSED);
     LWIP_ASSERT("tcp_input: active pcb->state != TIME-WAIT", pcb->state != TIME_WAIT);
     LWIP_ASSERT("tcp_input: active pcb->state != LISTEN", pcb->state != LISTEN);
@@ -266,15 +287,15 @@ tcp_input(struct pbuf *p, struct netif *inp)
       /* Move this PCB to the front of the list so that subsequent
          lookups will be faster (we exploit locality in TCP segment
          arrivals). */
-      LWIP_ASSERT("tcp_input: pcb->next != pcb (before cache)", pcb->next != pcb);
+      LWIP_ASSERT("tcp_input: pcb->next != pcb (before cache)", TCP_PCB_LIST_NEXT(pcb) != pcb);
       if (prev != NULL) {
-        prev->next = pcb->next;
-        pcb->next = tcp_active_pcbs;
-        tcp_active_pcbs = pcb;
+        TCP_PCB_LIST_NEXT(prev) = TCP_PCB_LIST_NEXT(pcb);
+        TCP_PCB_LIST_NEXT(pcb) = *pcbs;
+        *pcbs = pcb;
       } else {
         TCP_STATS_INC(tcp.cachehit);
       }
-      LWIP_ASSERT("tcp_input: pcb->next != pcb (after cache)", pcb->next != pcb);
+      LWIP_ASSERT("tcp_input: pcb->next != pcb (after cache)", TCP_PCB_LIST_NEXT(pcb) != pcb);
       break;
     }
     prev = pcb;
@@ -283,7 +304,12 @@ tcp_input(struct pbuf *p, struct netif *inp)
   if (pcb == NULL) {
     /* If it did not go to an active connection, we check the connections
        in the TIME-WAIT state. */
-    for (pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
+#if TCP_PCB_HASH
+    pcbs = &tcp_tw_hash[hash_idx];
+#else /* TCP_PCB_HASH */
+    pcbs = &tcp_tw_pcbs;
+#endif /* TCP_PCB_HASH */
+    for (pcb = *pcbs; pcb != NULL; pcb = TCP_PCB_LIST_NEXT(pcb)) {
       LWIP_ASSERT("tcp_input: TIME-WAIT pcb->state == TIME-WAIT", pcb->state == TIME_WAIT);
 
       /* check if PCB is bound to specific netif */
@@ -315,7 +341,12 @@ tcp_input(struct pbuf *p, struct netif *inp)
     /* Finally, if we still did not get a match, we check all PCBs that
        are LISTENing for incoming connections. */
     prev = NULL;
-    for (lpcb = tcp_listen_pcbs.listen_pcbs; lpcb != NULL; lpcb = lpcb->next) {
+#if TCP_PCB_HASH
+    lpcbs = &tcp_listen_hash[TCP_LISTEN_HASH_IDX(tcphdr->dest)];
+#else /* TCP_PCB_HASH */
+    lpcbs = &tcp_listen_pcbs;
+#endif /* TCP_PCB_HASH */
+    for (lpcb = lpcbs->listen_pcbs; lpcb != NULL; lpcb = TCP_PCB_LIST_NEXT(lpcb)) {
       /* check if PCB is bound to specific netif */
       if ((lpcb->netif_idx != NETIF_NO_INDEX) &&
           (lpcb->netif_idx != netif_get_index(ip_data.current_input_netif))) {
@@ -362,11 +393,11 @@ tcp_input(struct pbuf *p, struct netif *inp)
          lookups will be faster (we exploit locality in TCP segment
          arrivals). */
       if (prev != NULL) {
-        ((struct tcp_pcb_listen *)prev)->next = lpcb->next;
+        TCP_PCB_LIST_NEXT((struct tcp_pcb_listen *)prev) = TCP_PCB_LIST_NEXT(lpcb);
         /* our successor is the remainder of the listening list */
-        lpcb->next = tcp_listen_pcbs.listen_pcbs;
+        TCP_PCB_LIST_NEXT(lpcb) = lpcbs->listen_pcbs;
         /* put this listening pcb at the head of the listening list */
-        tcp_listen_pcbs.listen_pcbs = lpcb;
+        lpcbs->listen_pcbs = lpcb;
       } else {
         TCP_STATS_INC(tcp.cachehit);
       }
@@ -1090,10 +1121,17 @@ tcp_free_acked_segments(struct tcp_pcb *pcb, struct tcp_seg *seg_list, const cha
 {
   struct tcp_seg *next;
   u16_t clen;
+  struct pbuf_batch pbufs;
+  struct memp_batch segs;
 
   LWIP_UNUSED_ARG(dbg_list_name);
   LWIP_UNUSED_ARG(dbg_other_seg_list);
 
+  /* an ACK often covers several segments: return their pbufs and tcp_segs
+     to the pools together instead of one protect section per element */
+  pbuf_batch_init(&pbufs);
+  memp_batch_init(&segs, MEMP_TCP_SEG);
+
   while (seg_list != NULL &&
          TCP_SEQ_LEQ(lwip_ntohl(seg_list->tcphdr->seqno) +
                      TCP_TCPLEN(seg_list), ackno)) {
@@ -1112,7 +1150,10 @@ tcp_free_acked_segments(struct tcp_pcb *pcb, struct tcp_seg *seg_list, const cha
 
     pcb->snd_queuelen = (u16_t)(pcb->snd_queuelen - clen);
     recv_acked = (tcpwnd_size_t)(recv_acked + next->len);
-    tcp_seg_free(next);
+    if (next->p != NULL) {
+      pbuf_free_deferred(&pbufs, next->p);
+    }
+    memp_batch_add(&segs, next);
 
     LWIP_DEBUGF(TCP_QLEN_DEBUG, ("%"TCPWNDSIZE_F" (after freeing %s)\n",
                                  (tcpwnd_size_t)pcb->snd_queuelen,
@@ -1122,6 +1163,8 @@ tcp_free_acked_segments(struct tcp_pcb *pcb, struct tcp_seg *seg_list, const cha
                   seg_list != NULL || dbg_other_seg_list != NULL);
     }
   }
+  pbuf_batch_flush(&pbufs);
+  memp_batch_free(&segs);
   return seg_list;
 }
 
@@ -1342,9 +1385,21 @@ tcp_receive(struct tcp_pcb *pcb)
        incoming segment acknowledges the segment we use to take a
        round-trip time measurement. */
     if (pcb->rttest && TCP_SEQ_LT(pcb->rtseq, ackno)) {
+#if LWIP_TCP_RTT_US
+      /* time the sample in microseconds and round it up to whole timer
+         ticks, so sub-tick RTTs do not alternate between 0 and 1 ticks */
+      u32_t rtt_us = sys_now_us() - pcb->rttest_us;
+      if (pcb->srtt_us == 0) {
+        pcb->srtt_us = rtt_us;
+      } else {
+        pcb->srtt_us = pcb->srtt_us - (pcb->srtt_us >> 3) + (rtt_us >> 3);
+      }
+      m = (s16_t)LWIP_MIN((rtt_us + (TCP_SLOW_INTERVAL * 1000UL) - 1) / (TCP_SLOW_INTERVAL * 1000UL), 0x7FFF);
+#else /* LWIP_TCP_RTT_US */
       /* diff between this shouldn't exceed 32K since this are tcp timer ticks
          and a round-trip shouldn't be that long... */
       m = (s16_t)(tcp_ticks - pcb->rttest);
+#endif /* LWIP_TCP_RTT_US */
 
       LWIP_DEBUGF(TCP_RTO_DEBUG, ("tcp_receive: experienced rtt %"U16_F" ticks (%"U16_F" msec).\n",
                                   m, (u16_t)(m * TCP_SLOW_INTERVAL)));
@@ -80,6 +80,24 @@ static u16_t udp_port = UDP_LOCAL_PORT_RANGE_START;
 /* exported in udp.h (was static) */
 struct udp_pcb *udp_pcbs;
 
+#if UDP_PCB_HASH
+#if (UDP_PCB_HASH_SIZE & (UDP_PCB_HASH_SIZE - 1)) != 0
+#error "UDP_PCB_HASH_SIZE must be a power of 2"
+#endif
+/* udp_pcbs indexed by local port, chained through pcb->hash_next. Kept up to
+   date by udp_bind(), udp_connect() and udp_remove(); the local port of a pcb
+   on udp_pcbs is only changed by udp_bind(). Every chain keeps the udp_pcbs
+   order of its pcbs, so udp_pcbs is also linked backwards through pcb->prev
+   for the move-to-front in udp_input(). */
+static struct udp_pcb *udp_pcb_hash[UDP_PCB_HASH_SIZE];
+#define UDP_PCB_HASH_CHAIN(port) (&udp_pcb_hash[(port) & (UDP_PCB_HASH_SIZE - 1)])
+/* lookups by local port only walk the hash chain of that port */
+#define UDP_PCB_LIST_NEXT(pcb)   ((pcb)->hash_next)
+#else /* UDP_PCB_HASH */
+#define UDP_PCB_HASH_CHAIN(port) (&udp_pcbs)
+#define UDP_PCB_LIST_NEXT(pcb)   ((pcb)->next)
+#endif /* UDP_PCB_HASH */
+
 /**
  * Initialize this module.
  */
@@ -107,7 +125,7 @@ again:
     udp_port = UDP_LOCAL_PORT_RANGE_START;
   }
   /* Check all PCBs. */
-  for (pcb = udp_pcbs; pcb != NULL; pcb = pcb->next) {
+  for (pcb = *UDP_PCB_HASH_CHAIN(udp_port); pcb != NULL; pcb = UDP_PCB_LIST_NEXT(pcb)) {
     if (pcb->local_port == udp_port) {
       if (++n > (UDP_LOCAL_PORT_RANGE_END - UDP_LOCAL_PORT_RANGE_START)) {
         return 0;
@@ -118,6 +136,97 @@ again:
   return udp_port;
 }
 
+#if UDP_PCB_HASH
+/** Add a pcb that has just been put at the front of udp_pcbs to the hash
+ * chain of its local port */
+static void
+udp_pcb_hash_add(struct udp_pcb *pcb)
+{
+  struct udp_pcb **chain = UDP_PCB_HASH_CHAIN(pcb->local_port);
+
+  pcb->prev = NULL;
+  if (pcb->next != NULL) {
+    pcb->next->prev = pcb;
+  }
+  pcb->hash_next = *chain;
+  *chain = pcb;
+}
+
+/**
+ * Add a pcb that keeps its place on udp_pcbs (rebound to another port) to
+ * the hash chain of its new local port. It is inserted in front of the first
+ * pcb of that chain that follows it on udp_pcbs, so the chain keeps the
+ * udp_pcbs order and udp_input() picks the same unconnected pcb as without
+ * the hash.
+ */
+static void
+udp_pcb_hash_insert(struct udp_pcb *pcb)
+{
+  struct udp_pcb **chain = UDP_PCB_HASH_CHAIN(pcb->local_port);
+  struct udp_pcb *next;
+
+  for (next = pcb->next; next != NULL; next = next->next) {
+    if (UDP_PCB_HASH_CHAIN(next->local_port) == chain) {
+      break;
+    }
+  }
+  /* next == NULL: nothing behind it, append to the chain */
+  while ((*chain != NULL) && (*chain != next)) {
+    chain = &(*chain)->hash_next;
+  }
+  pcb->hash_next = *chain;
+  *chain = pcb;
+}
+
+/** Remove a pcb from the hash chain of its local port */
+static void
+udp_pcb_hash_remove(struct udp_pcb *pcb)
+{
+  struct udp_pcb **chain;
+
+  for (chain = UDP_PCB_HASH_CHAIN(pcb->local_port); *chain != NULL; chain = &(*chain)->hash_next) {
+    if (*chain == pcb) {
+      *chain = pcb->hash_next;
+      break;
+    }
+  }
+  pcb->hash_next = NULL;
+}
+
+/** Remove a pcb that has just been unlinked from udp_pcbs from its hash chain */
+static void
+udp_pcb_hash_unlink(struct udp_pcb *pcb)
+{
+  if (pcb->next != NULL) {
+    pcb->next->prev = pcb->prev;
+  }
+  pcb->prev = NULL;
+  udp_pcb_hash_remove(pcb);
+}
+
+/**
+ * Move a pcb to the front of udp_pcbs, as udp_input() does without the hash.
+ * The hash chains must keep the udp_pcbs order (see udp_pcb_hash_insert()),
+ * and which pcb gets a datagram later must not depend on UDP_PCB_HASH.
+ */
+static void
+udp_pcb_move_to_front(struct udp_pcb *pcb)
+{
+  if (pcb->prev == NULL) {
+    /* already first */
+    return;
+  }
+  pcb->prev->next = pcb->next;
+  if (pcb->next != NULL) {
+    pcb->next->prev = pcb->prev;
+  }
+  pcb->prev = NULL;
+  pcb->next = udp_pcbs;
+  udp_pcbs->prev = pcb;
+  udp_pcbs = pcb;
+}
+#endif /* UDP_PCB_HASH */
+
 /** Common code to see if the current input packet matches the pcb
  * (current input packet is accessed via ip(4/6)_current_* macros)
  *
@@ -195,6 +304,7 @@ udp_input(struct pbuf *p, struct netif *inp)
 {
   struct udp_hdr *udphdr;
   struct udp_pcb *pcb, *prev;
+  struct udp_pcb **pcbs;
   struct udp_pcb *uncon_pcb;
   u16_t src, dest;
   u8_t broadcast;
@@ -249,8 +359,11 @@ udp_input(struct pbuf *p, struct netif *inp)
   /* Iterate through the UDP pcb list for a matching pcb.
    * 'Perfect match' pcbs (connected to the remote port & ip address) are
    * preferred. If no perfect match is found, the first unconnected pcb that
-   * matches the local port and ip address gets the datagram. */
-  for (pcb = udp_pcbs; pcb != NULL; pcb = pcb->next) {
+   * matches the local port and ip address gets the datagram.
+   * With UDP_PCB_HASH, only the pcbs on the hash chain of the destination
+   * port are checked, in the same relative order as on udp_pcbs. */
+  pcbs = UDP_PCB_HASH_CHAIN(dest);
+  for (pcb = *pcbs; pcb != NULL; pcb = UDP_PCB_LIST_NEXT(pcb)) {
     /* print the PCB local and remote address */
     LWIP_DEBUGF(UDP_DEBUG, ("pcb ("));
     ip_addr_debug_print_val(UDP_DEBUG, pcb->local_ip);
@@ -291,14 +404,18 @@ udp_input(struct pbuf *p, struct netif *inp)
            ip_addr_cmp(&pcb->remote_ip, ip_current_src_addr()))) {
         /* the first fully matching PCB */
         if (prev != NULL) {
-          /* move the pcb to the front of udp_pcbs so that is
-             found faster next time */
-          prev->next = pcb->next;
-          pcb->next = udp_pcbs;
-          udp_pcbs = pcb;
+          /* move the pcb to the front of udp_pcbs (or its hash chain)
+             so that is found faster next time */
+          UDP_PCB_LIST_NEXT(prev) = UDP_PCB_LIST_NEXT(pcb);
+          UDP_PCB_LIST_NEXT(pcb) = *pcbs;
+          *pcbs = pcb;
         } else {
           UDP_STATS_INC(udp.cachehit);
         }
+#if UDP_PCB_HASH
+        /* the hash chain is only a part of udp_pcbs, move it there as well */
+        udp_pcb_move_to_front(pcb);
+#endif /* UDP_PCB_HASH */
         break;
       }
     }
@@ -329,7 +446,7 @@ udp_input(struct pbuf *p, struct netif *inp)
   if (for_us) {
     LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE, ("udp_input: calculating checksum\n"));
 #if CHECKSUM_CHECK_UDP
-    IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_UDP) {
+    IF__NETIF_CHECKSUM_CHECK_RX(inp, p, NETIF_CHECKSUM_CHECK_UDP) {
 #if LWIP_UDPLITE
       if (ip_current_header_proto() == IP_PROTO_UDPLITE) {
         /* Do the UDP Lite checksum */
@@ -354,9 +471,9 @@ udp_input(struct pbuf *p, struct netif *inp)
 #endif /* LWIP_UDPLITE */
       {
         if (udphdr->chksum != 0) {
-          if (ip_chksum_pseudo(p, IP_PROTO_UDP, p->tot_len,
-                               ip_current_src_addr(),
-                               ip_current_dest_addr()) != 0) {
+          if (ip_chksum_pseudo_rx(p, IP_PROTO_UDP, p->tot_len,
+                                  ip_current_src_addr(),
+                                  ip_current_dest_addr()) != 0) {
             goto chkerr;
           }
         }
@@ -380,7 +497,7 @@ udp_input(struct pbuf *p, struct netif *inp)
         /* pass broadcast- or multicast packets to all multicast pcbs
            if SOF_REUSEADDR is set on the first match */
         struct udp_pcb *mpcb;
-        for (mpcb = udp_pcbs; mpcb != NULL; mpcb = mpcb->next) {
+        for (mpcb = *pcbs; mpcb != NULL; mpcb = UDP_PCB_LIST_NEXT(mpcb)) {
           if (mpcb != pcb) {
             /* compare PCB local addr+port to UDP destination addr+port */
             if ((mpcb->local_port == dest) &&
@@ -985,7 +1102,7 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
       return ERR_USE;
     }
   } else {
-    for (ipcb = udp_pcbs; ipcb != NULL; ipcb = ipcb->next) {
+    for (ipcb = *UDP_PCB_HASH_CHAIN(port); ipcb != NULL; ipcb = UDP_PCB_LIST_NEXT(ipcb)) {
       if (pcb != ipcb) {
         /* By default, we don't allow to bind to a port that any other udp
            PCB is already bound to, unless *all* PCBs with that port have tha
@@ -1012,6 +1129,14 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
 
   ip_addr_set_ipaddr(&pcb->local_ip, ipaddr);
 
+#if UDP_PCB_HASH
+  /* rebinding to another port moves the pcb to another hash chain */
+  if (rebind && (pcb->local_port != port)) {
+    udp_pcb_hash_remove(pcb);
+    pcb->local_port = port;
+    udp_pcb_hash_insert(pcb);
+  }
+#endif /* UDP_PCB_HASH */
   pcb->local_port = port;
   mib2_udp_bind(pcb);
   /* pcb not active yet? */
@@ -1019,6 +1144,9 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     /* place the PCB on the active list if not already there */
     pcb->next = udp_pcbs;
     udp_pcbs = pcb;
+#if UDP_PCB_HASH
+    udp_pcb_hash_add(pcb);
+#endif /* UDP_PCB_HASH */
   }
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("udp_bind: bound to "));
   ip_addr_debug_print_val(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, pcb->local_ip);
@@ -1112,6 +1240,9 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
   /* PCB not yet on the list, add PCB now */
   pcb->next = udp_pcbs;
   udp_pcbs = pcb;
+#if UDP_PCB_HASH
+  udp_pcb_hash_add(pcb);
+#endif /* UDP_PCB_HASH */
   return ERR_OK;
 }
 
@@ -1189,6 +1320,9 @@ udp_remove(struct udp_pcb *pcb)
   if (udp_pcbs == pcb) {
     /* make list start at 2nd pcb */
     udp_pcbs = udp_pcbs->next;
+#if UDP_PCB_HASH
+    udp_pcb_hash_unlink(pcb);
+#endif /* UDP_PCB_HASH */
     /* pcb not 1st in list */
   } else {
     for (pcb2 = udp_pcbs; pcb2 != NULL; pcb2 = pcb2->next) {
@@ -1196,6 +1330,9 @@ udp_remove(struct udp_pcb *pcb)
       if (pcb2->next != NULL && pcb2->next == pcb) {
         /* remove pcb from list */
         pcb2->next = pcb->next;
+#if UDP_PCB_HASH
+        udp_pcb_hash_unlink(pcb);
+#endif /* UDP_PCB_HASH */
         break;
       }
     }
@@ -271,6 +271,16 @@ typedef int ssize_t;
 #define LWIP_DECLARE_MEMORY_ALIGNED(variable_name, size) u8_t variable_name[LWIP_MEM_ALIGN_BUFFER(size)]
 #endif
 
+/** Same as LWIP_DECLARE_MEMORY_ALIGNED, used for memory that carries frame
+ * data and may be handed to a network DMA: the heap (PBUF_RAM), PBUF_POOL and
+ * driver pools declared with LWIP_MEMPOOL_DECLARE_DMA. Define both macros to
+ * place protocol state (PCBs, timeouts, netconns...) in fast CPU-only memory
+ * and frame buffers in DMA-capable memory.
+ */
+#ifndef LWIP_DECLARE_DMA_MEMORY_ALIGNED
+#define LWIP_DECLARE_DMA_MEMORY_ALIGNED(variable_name, size) LWIP_DECLARE_MEMORY_ALIGNED(variable_name, size)
+#endif
+
 /** Calculate memory size for an aligned buffer - returns the next highest
  * multiple of MEM_ALIGNMENT (e.g. LWIP_MEM_ALIGN_SIZE(3) and
  * LWIP_MEM_ALIGN_SIZE(4) will both yield 4 for MEM_ALIGNMENT == 4).
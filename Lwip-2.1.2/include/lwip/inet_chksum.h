@@ -97,6 +97,17 @@ u16_t ip_chksum_pseudo(struct pbuf *p, u8_t proto, u16_t proto_len,
 u16_t ip_chksum_pseudo_partial(struct pbuf *p, u8_t proto, u16_t proto_len,
        u16_t chksum_len, const ip_addr_t *src, const ip_addr_t *dest);
 
+/* Checksum verification of received packets, reusing the checksums recorded
+   by the netif driver (LWIP_CHECKSUM_ON_RX_COPY) */
+#if LWIP_CHECKSUM_ON_RX_COPY
+u16_t ip_chksum_pseudo_rx(struct pbuf *p, u8_t proto, u16_t proto_len,
+       const ip_addr_t *src, const ip_addr_t *dest);
+u16_t inet_chksum_pbuf_rx(struct pbuf *p);
+#else /* LWIP_CHECKSUM_ON_RX_COPY */
+#define ip_chksum_pseudo_rx ip_chksum_pseudo
+#define inet_chksum_pbuf_rx inet_chksum_pbuf
+#endif /* LWIP_CHECKSUM_ON_RX_COPY */
+
 #ifdef __cplusplus
 }
 #endif
@@ -68,7 +68,7 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
 
 #if MEMP_MEM_MALLOC
 
-#define LWIP_MEMPOOL_DECLARE(name,num,size,desc) \
+#define LWIP_MEMPOOL_DECLARE_IN(declare_memory,name,num,size,desc) \
   LWIP_MEMPOOL_DECLARE_STATS_INSTANCE(memp_stats_ ## name) \
   const struct memp_desc memp_ ## name = { \
     DECLARE_LWIP_MEMPOOL_DESC(desc) \
@@ -78,6 +78,24 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
 
 #else /* MEMP_MEM_MALLOC */
 
+#define LWIP_MEMPOOL_DECLARE_IN(declare_memory,name,num,size,desc) \
+  declare_memory(memp_memory_ ## name ## _base, ((num) * (MEMP_SIZE + MEMP_ALIGN_SIZE(size)))); \
+    \
+  LWIP_MEMPOOL_DECLARE_STATS_INSTANCE(memp_stats_ ## name) \
+    \
+  static struct memp *memp_tab_ ## name; \
+    \
+  const struct memp_desc memp_ ## name = { \
+    DECLARE_LWIP_MEMPOOL_DESC(desc) \
+    LWIP_MEMPOOL_DECLARE_STATS_REFERENCE(memp_stats_ ## name) \
+    LWIP_MEM_ALIGN_SIZE(size), \
+    (num), \
+    memp_memory_ ## name ## _base, \
+    &memp_tab_ ## name \
+  };
+
+#endif /* MEMP_MEM_MALLOC */
+
 /**
  * @ingroup mempool
  * Declare a private memory pool
@@ -93,22 +111,15 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
  *   extern u8_t \_\_attribute\_\_((section(".onchip_mem"))) memp_memory_my_private_pool_base[];
  */
 #define LWIP_MEMPOOL_DECLARE(name,num,size,desc) \
-  LWIP_DECLARE_MEMORY_ALIGNED(memp_memory_ ## name ## _base, ((num) * (MEMP_SIZE + MEMP_ALIGN_SIZE(size)))); \
-    \
-  LWIP_MEMPOOL_DECLARE_STATS_INSTANCE(memp_stats_ ## name) \
-    \
-  static struct memp *memp_tab_ ## name; \
-    \
-  const struct memp_desc memp_ ## name = { \
-    DECLARE_LWIP_MEMPOOL_DESC(desc) \
-    LWIP_MEMPOOL_DECLARE_STATS_REFERENCE(memp_stats_ ## name) \
-    LWIP_MEM_ALIGN_SIZE(size), \
-    (num), \
-    memp_memory_ ## name ## _base, \
-    &memp_tab_ ## name \
-  };
+  LWIP_MEMPOOL_DECLARE_IN(LWIP_DECLARE_MEMORY_ALIGNED,name,num,size,desc)
 
-#endif /* MEMP_MEM_MALLOC */
+/**
+ * @ingroup mempool
+ * Declare a private memory pool whose elements are accessed by DMA (e.g.
+ * driver RX buffers), see LWIP_DECLARE_DMA_MEMORY_ALIGNED
+ */
+#define LWIP_MEMPOOL_DECLARE_DMA(name,num,size,desc) \
+  LWIP_MEMPOOL_DECLARE_IN(LWIP_DECLARE_DMA_MEMORY_ALIGNED,name,num,size,desc)
 
 /**
  * @ingroup mempool
@@ -148,6 +159,22 @@ void *memp_malloc(memp_t type);
 #endif
 void  memp_free(memp_t type, void *mem);
 
+/**
+ * @ingroup mempool
+ * Elements of one pool collected with memp_batch_add() and put back into
+ * the pool by memp_batch_free() inside a single SYS_ARCH_PROTECT section.
+ */
+struct memp_batch {
+  struct memp *first;
+  struct memp *last;
+  u16_t count;
+  memp_t type;
+};
+
+void  memp_batch_init(struct memp_batch *batch, memp_t type);
+void  memp_batch_add(struct memp_batch *batch, void *mem);
+void  memp_batch_free(struct memp_batch *batch);
+
 #ifdef __cplusplus
 }
 #endif
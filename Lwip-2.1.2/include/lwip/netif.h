@@ -397,6 +397,11 @@ struct netif {
 #define NETIF_SET_CHECKSUM_CTRL(netif, chksumflags)
 #define IF__NETIF_CHECKSUM_ENABLED(netif, chksumflag)
 #endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
+/** Like IF__NETIF_CHECKSUM_ENABLED() for verifying the checksum of a received
+ * packet p: also skipped if the netif hardware has already verified it
+ * (PBUF_FLAG_RX_HWCHKSUM) */
+#define IF__NETIF_CHECKSUM_CHECK_RX(netif, p, chksumflag) \
+  if (((p)->flags & PBUF_FLAG_RX_HWCHKSUM) == 0) IF__NETIF_CHECKSUM_ENABLED(netif, chksumflag)
 
 #if LWIP_SINGLE_NETIF
 #define NETIF_FOREACH(netif) if (((netif) = netif_default) != NULL)
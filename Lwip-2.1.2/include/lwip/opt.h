@@ -706,6 +706,26 @@
 #if !defined ETHARP_TABLE_MATCH_NETIF || defined __DOXYGEN__
 #define ETHARP_TABLE_MATCH_NETIF        !LWIP_SINGLE_NETIF
 #endif
+
+/** ETHARP_TABLE_HASH==1: Split the ARP table into sets of ETHARP_TABLE_HASH_WAYS
+ * entries, selected by a hash of the IP address. An address is only searched
+ * for within its own set, so lookups stay cheap for an ARP_TABLE_SIZE of a few
+ * hundred entries. The per-pcb cached entry (LWIP_NETIF_HWADDRHINT) is still
+ * checked first. When a set is full, its least recently used entry is recycled:
+ * every hit in etharp_output() or etharp_find_entry() stamps the entry.
+ * ARP_TABLE_SIZE must be a multiple of ETHARP_TABLE_HASH_WAYS.
+ */
+#if !defined ETHARP_TABLE_HASH || defined __DOXYGEN__
+#define ETHARP_TABLE_HASH               0
+#endif
+
+/** ETHARP_TABLE_HASH_WAYS: Number of entries per set when ETHARP_TABLE_HASH==1.
+ * This is the number of addresses with the same hash that can be cached at
+ * the same time.
+ */
+#if !defined ETHARP_TABLE_HASH_WAYS || defined __DOXYGEN__
+#define ETHARP_TABLE_HASH_WAYS          4
+#endif
 /**
  * @}
  */
@@ -1200,6 +1220,24 @@
 #if !defined LWIP_NETBUF_RECVINFO || defined __DOXYGEN__
 #define LWIP_NETBUF_RECVINFO            0
 #endif
+
+/**
+ * UDP_PCB_HASH==1: Index udp_pcbs by local port, so that udp_input() and
+ * port allocation only walk the pcbs sharing one hash chain instead of all
+ * of them. Which pcb gets a datagram is the same as without the index.
+ * Costs two pointers per pcb plus the hash table.
+ */
+#if !defined UDP_PCB_HASH || defined __DOXYGEN__
+#define UDP_PCB_HASH                    0
+#endif
+
+/**
+ * UDP_PCB_HASH_SIZE: Number of hash chains for udp_pcbs (power of 2).
+ * Only used if UDP_PCB_HASH is enabled.
+ */
+#if !defined UDP_PCB_HASH_SIZE || defined __DOXYGEN__
+#define UDP_PCB_HASH_SIZE               16
+#endif
 /**
  * @}
  */
@@ -1268,6 +1306,42 @@
 #define LWIP_TCP_SACK_OUT               0
 #endif
 
+/**
+ * LWIP_TCP_RTT_US==1: Time the RTT sample of each TCP connection with the
+ * microsecond clock sys_now_us() (provided by the port) instead of the
+ * 500ms slow timer ticks. The sample is rounded up to slow timer ticks for
+ * the RTO estimator and the smoothed RTT is kept in pcb->srtt_us.
+ */
+#if !defined LWIP_TCP_RTT_US || defined __DOXYGEN__
+#define LWIP_TCP_RTT_US                 0
+#endif
+
+/**
+ * TCP_PCB_HASH==1: Index active and TIME-WAIT pcbs by their 4-tuple and
+ * listening pcbs by their local port, so that tcp_input() only walks one
+ * short hash chain instead of the whole pcb lists for every segment.
+ * Costs one pointer per pcb plus the hash tables.
+ */
+#if !defined TCP_PCB_HASH || defined __DOXYGEN__
+#define TCP_PCB_HASH                    0
+#endif
+
+/**
+ * TCP_PCB_HASH_SIZE: Number of hash chains for active pcbs and for
+ * TIME-WAIT pcbs each (power of 2). Only used if TCP_PCB_HASH is enabled.
+ */
+#if !defined TCP_PCB_HASH_SIZE || defined __DOXYGEN__
+#define TCP_PCB_HASH_SIZE               32
+#endif
+
+/**
+ * TCP_LISTEN_HASH_SIZE: Number of hash chains for listening pcbs, keyed by
+ * the local port (power of 2). Only used if TCP_PCB_HASH is enabled.
+ */
+#if !defined TCP_LISTEN_HASH_SIZE || defined __DOXYGEN__
+#define TCP_LISTEN_HASH_SIZE            8
+#endif
+
 /**
  * LWIP_TCP_MAX_SACK_NUM: The maximum number of SACK values to include in TCP segments.
  * Must be at least 1, but is only used if LWIP_TCP_SACK_OUT is enabled.
@@ -1775,6 +1849,28 @@
 #define TCPIP_MBOX_SIZE                 0
 #endif
 
+/**
+ * LWIP_TCPIP_MBOX_HI==1: Give the tcpip thread mailbox a second, high
+ * priority queue of TCPIP_MBOX_HI_SIZE entries. Received packets
+ * (tcpip_inpkt) are queued there and handled before any message waiting in
+ * the normal TCPIP_MBOX_SIZE queue, so a backlog of API work does not delay
+ * RX processing. All other messages (including tcpip_timeout/untimeout)
+ * stay in the normal queue and keep their order. The port has to provide
+ * sys_mbox_new_prio(), sys_mbox_trypost_prio() and sys_mbox_get_depth().
+ */
+#if !defined LWIP_TCPIP_MBOX_HI || defined __DOXYGEN__
+#define LWIP_TCPIP_MBOX_HI              0
+#endif
+
+/**
+ * TCPIP_MBOX_HI_SIZE: Depth of the high priority queue enabled by
+ * LWIP_TCPIP_MBOX_HI. It is only used in C expressions, so it may be derived
+ * from driver constants that cannot be evaluated by #if.
+ */
+#if !defined TCPIP_MBOX_HI_SIZE || defined __DOXYGEN__
+#define TCPIP_MBOX_HI_SIZE              0
+#endif
+
 /**
  * Define this to something that triggers a watchdog. This is called from
  * tcpip_thread after processing a message.
@@ -2352,6 +2448,16 @@
 #if !defined LWIP_CHECKSUM_ON_COPY || defined __DOXYGEN__
 #define LWIP_CHECKSUM_ON_COPY           1
 #endif
+
+/**
+ * LWIP_CHECKSUM_ON_RX_COPY==1: Let netif drivers that copy received frames
+ * into pbufs record the checksum of each pbuf (pbuf_set_rx_chksum()) so that
+ * TCP, UDP and ICMP checksum verification does not read the data again.
+ * Adds the recorded sum, its length and start address to struct pbuf.
+ */
+#if !defined LWIP_CHECKSUM_ON_RX_COPY || defined __DOXYGEN__
+#define LWIP_CHECKSUM_ON_RX_COPY        0
+#endif
 /**
  * @}
  */
@@ -181,6 +181,11 @@ typedef enum {
 #define PBUF_FLAG_LLMCAST   0x10U
 /** indicates this pbuf includes a TCP FIN flag */
 #define PBUF_FLAG_TCP_FIN   0x20U
+/** indicates rx_chksum holds the checksum recorded by the netif driver */
+#define PBUF_FLAG_RX_CHKSUM 0x40U
+/** indicates the netif hardware has verified the TCP/UDP/ICMP checksum of this
+    received packet (set on the first pbuf of the chain by the netif driver) */
+#define PBUF_FLAG_RX_HWCHKSUM 0x80U
 
 /** Main packet buffer struct */
 struct pbuf {
@@ -219,6 +224,15 @@ struct pbuf {
 
   /** For incoming packets, this contains the input netif's index */
   u8_t if_idx;
+
+#if LWIP_CHECKSUM_ON_RX_COPY
+  /** For incoming packets: one's complement sum (as returned by LWIP_CHKSUM)
+      of rx_chksum_len bytes starting at rx_chksum_start, recorded by the netif
+      driver while copying the frame. Only valid if PBUF_FLAG_RX_CHKSUM is set. */
+  u16_t rx_chksum;
+  u16_t rx_chksum_len;
+  const void *rx_chksum_start;
+#endif /* LWIP_CHECKSUM_ON_RX_COPY */
 };
 
 
@@ -269,6 +283,12 @@ void pbuf_free_ooseq(void);
 /* Initializes the pbuf module. This call is empty for now, but may not be in future. */
 #define pbuf_init()
 
+/** @ingroup pbuf
+ * pbufs released with pbuf_free_deferred(), deallocated together by pbuf_batch_flush() */
+struct pbuf_batch {
+  struct pbuf *list;
+};
+
 struct pbuf *pbuf_alloc(pbuf_layer l, u16_t length, pbuf_type type);
 struct pbuf *pbuf_alloc_reference(void *payload, u16_t length, pbuf_type type);
 #if LWIP_SUPPORT_CUSTOM_PBUF
@@ -288,6 +308,9 @@ u8_t pbuf_remove_header(struct pbuf *p, size_t header_size);
 struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size);
 void pbuf_ref(struct pbuf *p);
 u8_t pbuf_free(struct pbuf *p);
+void pbuf_batch_init(struct pbuf_batch *batch);
+u8_t pbuf_free_deferred(struct pbuf_batch *batch, struct pbuf *p);
+void pbuf_batch_flush(struct pbuf_batch *batch);
 u16_t pbuf_clen(const struct pbuf *p);
 void pbuf_cat(struct pbuf *head, struct pbuf *tail);
 void pbuf_chain(struct pbuf *head, struct pbuf *tail);
@@ -299,6 +322,12 @@ err_t pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len);
 err_t pbuf_take_at(struct pbuf *buf, const void *dataptr, u16_t len, u16_t offset);
 struct pbuf *pbuf_skip(struct pbuf* in, u16_t in_offset, u16_t* out_offset);
 struct pbuf *pbuf_coalesce(struct pbuf *p, pbuf_layer layer);
+#if LWIP_CHECKSUM_ON_RX_COPY
+void pbuf_set_rx_chksum(struct pbuf *p, u16_t chksum);
+void pbuf_clear_rx_chksum(struct pbuf *p);
+#else /* LWIP_CHECKSUM_ON_RX_COPY */
+#define pbuf_clear_rx_chksum(p)
+#endif /* LWIP_CHECKSUM_ON_RX_COPY */
 struct pbuf *pbuf_clone(pbuf_layer l, pbuf_type type, struct pbuf *p);
 #if LWIP_CHECKSUM_ON_COPY
 err_t pbuf_fill_chksum(struct pbuf *p, u16_t start_offset, const void *dataptr,
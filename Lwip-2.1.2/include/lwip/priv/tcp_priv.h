@@ -343,6 +343,26 @@ extern struct tcp_pcb *tcp_tw_pcbs;      /* List of all TCP PCBs in TIME-WAIT. *
 #define NUM_TCP_PCB_LISTS               4
 extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
 
+#if TCP_PCB_HASH
+/* Hash indexes of the active, TIME-WAIT and listen lists (chained through
+   pcb->hash_next), kept up to date by TCP_REG and TCP_RMV. The lists stay
+   complete, the tables are only used to find the pcb of an incoming segment. */
+extern struct tcp_pcb *tcp_active_hash[TCP_PCB_HASH_SIZE];
+extern struct tcp_pcb *tcp_tw_hash[TCP_PCB_HASH_SIZE];
+extern union tcp_listen_pcbs_t tcp_listen_hash[TCP_LISTEN_HASH_SIZE];
+
+#define TCP_LISTEN_HASH_IDX(port) ((port) & (TCP_LISTEN_HASH_SIZE - 1))
+
+u16_t tcp_pcb_hash_idx(const ip_addr_t *remote_ip, u16_t local_port, u16_t remote_port);
+void tcp_pcb_hash_add(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+void tcp_pcb_hash_remove(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+#define TCP_PCB_HASH_ADD(pcbs, npcb) tcp_pcb_hash_add(pcbs, npcb)
+#define TCP_PCB_HASH_RMV(pcbs, npcb) tcp_pcb_hash_remove(pcbs, npcb)
+#else /* TCP_PCB_HASH */
+#define TCP_PCB_HASH_ADD(pcbs, npcb)
+#define TCP_PCB_HASH_RMV(pcbs, npcb)
+#endif /* TCP_PCB_HASH */
+
 /* Axioms about the above lists:
    1) Every TCP PCB that is not CLOSED is in one of the lists.
    2) A PCB is only in one of the lists.
@@ -367,6 +387,7 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
                             (npcb)->next = *(pcbs); \
                             LWIP_ASSERT("TCP_REG: npcb->next != npcb", (npcb)->next != (npcb)); \
                             *(pcbs) = (npcb); \
+                            TCP_PCB_HASH_ADD(pcbs, npcb); \
                             LWIP_ASSERT("TCP_REG: tcp_pcbs sane", tcp_pcbs_sane()); \
               tcp_timer_needed(); \
                             } while(0)
@@ -383,6 +404,7 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
                                } \
                             } \
                             (npcb)->next = NULL; \
+                            TCP_PCB_HASH_RMV(pcbs, npcb); \
                             LWIP_ASSERT("TCP_RMV: tcp_pcbs sane", tcp_pcbs_sane()); \
                             LWIP_DEBUGF(TCP_DEBUG, ("TCP_RMV: removed %p from %p\n", (void *)(npcb), (void *)(*(pcbs)))); \
                             } while(0)
@@ -393,6 +415,7 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
   do {                                             \
     (npcb)->next = *pcbs;                          \
     *(pcbs) = (npcb);                              \
+    TCP_PCB_HASH_ADD(pcbs, npcb);                  \
     tcp_timer_needed();                            \
   } while (0)
 
@@ -413,6 +436,7 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
       }                                            \
     }                                              \
     (npcb)->next = NULL;                           \
+    TCP_PCB_HASH_RMV(pcbs, npcb);                  \
   } while(0)
 
 #endif /* LWIP_DEBUG */
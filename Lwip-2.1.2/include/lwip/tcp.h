@@ -209,8 +209,15 @@ typedef u16_t tcpflags_t;
 /**
  * members common to struct tcp_pcb and struct tcp_listen_pcb
  */
+#if TCP_PCB_HASH
+#define TCP_PCB_HASH_NEXT(type) type *hash_next; /* for the hash chain */
+#else /* TCP_PCB_HASH */
+#define TCP_PCB_HASH_NEXT(type)
+#endif /* TCP_PCB_HASH */
+
 #define TCP_PCB_COMMON(type) \
   type *next; /* for the linked list */ \
+  TCP_PCB_HASH_NEXT(type) \
   void *callback_arg; \
   TCP_PCB_EXTARGS \
   enum tcp_state state; /* TCP state */ \
@@ -300,6 +307,10 @@ struct tcp_pcb {
   u32_t rttest; /* RTT estimate in 500ms ticks */
   u32_t rtseq;  /* sequence number being timed */
   s16_t sa, sv; /* @see "Congestion Avoidance and Control" by Van Jacobson and Karels */
+#if LWIP_TCP_RTT_US
+  u32_t rttest_us; /* sys_now_us() when the timed segment was sent */
+  u32_t srtt_us;   /* smoothed RTT in microseconds, 0 until the first sample */
+#endif /* LWIP_TCP_RTT_US */
 
   s16_t rto;    /* retransmission time-out (in ticks of TCP_SLOW_INTERVAL) */
   u8_t nrtx;    /* number of retransmissions */
@@ -79,6 +79,10 @@ void   tcpip_init(tcpip_init_done_fn tcpip_init_done, void *arg);
 err_t  tcpip_inpkt(struct pbuf *p, struct netif *inp, netif_input_fn input_fn);
 err_t  tcpip_input(struct pbuf *p, struct netif *inp);
 
+#if LWIP_TCPIP_MBOX_HI
+void   tcpip_get_mbox_depth(u16_t *api, u16_t *rx, u16_t *api_max, u16_t *rx_max);
+#endif /* LWIP_TCPIP_MBOX_HI */
+
 err_t  tcpip_try_callback(tcpip_callback_fn function, void *ctx);
 err_t  tcpip_callback(tcpip_callback_fn function, void *ctx);
 /**  @ingroup lwip_os
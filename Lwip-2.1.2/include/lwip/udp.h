@@ -85,6 +85,13 @@ struct udp_pcb {
 /* Protocol specific PCB members */
 
   struct udp_pcb *next;
+#if UDP_PCB_HASH
+  /** next pcb on the same local port hash chain */
+  struct udp_pcb *hash_next;
+  /** previous pcb on udp_pcbs, so udp_input() can move a pcb to the front
+      without walking the list */
+  struct udp_pcb *prev;
+#endif /* UDP_PCB_HASH */
 
   u8_t flags;
   /** ports are in host byte order */
@@ -0,0 +1,373 @@
+/**
+ * @file
+ * TCP_PCB_HASH的主机测试：建立BENCH_CONNS个连接后测量tcp_input()查找pcb的时间，
+ * 再让连接经过TIME-WAIT、FIN-WAIT-2超时、LAST-ACK、RST、SYN-RCVD超时和tcp_abort()，
+ * 覆盖TCP_REG/TCP_RMV和tcp_slowtmr中自己摘链的地方。每一步之后检查
+ * tcp_active_pcbs/tcp_tw_pcbs/tcp_listen_pcbs上的每个pcb恰好在一条(正确的)哈希链上
+ *
+ * 同一个源文件分别以TCP_PCB_HASH=0和1编译，比较两次的ns/segment
+ *
+ */
+
+#include "lwip/opt.h"
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/ip4.h"
+#include "lwip/tcp.h"
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/tcp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_CONNS         1000    /* 建立的连接数 */
+#define BENCH_LISTENERS     8       /* 监听端口数，连接平均分配到各个端口 */
+#define BENCH_HALF_OPEN     100     /* 只发SYN不完成握手的连接数，由tcp_slowtmr超时删除 */
+#define BENCH_ROUNDS        200     /* 计时阶段每个连接收到的报文段数 */
+#define BENCH_LOCAL_PORT    5000
+#define BENCH_REMOTE_PORT   40000
+
+static struct netif bench_netif;
+static struct tcp_pcb *bench_conns[BENCH_CONNS];
+static u32_t bench_peer_seq = 0x10000000UL;
+static u32_t bench_ms;
+static u32_t bench_accepted;
+static long bench_fail;
+
+u32_t
+sys_now(void)
+{
+  return bench_ms;
+}
+
+static err_t
+bench_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  return ERR_OK;
+}
+
+static err_t
+bench_netif_init(struct netif *netif)
+{
+  netif->output = bench_output;
+  netif->mtu = 1500;
+  return ERR_OK;
+}
+
+static err_t
+bench_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+  bench_accepted++;
+  return ERR_OK;
+}
+
+static void
+bench_remote_ip(int i, ip4_addr_t *ip)
+{
+  IP4_ADDR(ip, 10, 0, (u8_t)(i >> 8), (u8_t)i);
+}
+
+/* 构造对端发来的一个IPv4 TCP报文段，交给ip4_input() */
+static void
+bench_input(int i, u32_t seqno, u32_t ackno, u8_t flags)
+{
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  struct tcp_hdr *tcphdr;
+  ip4_addr_t src;
+
+  p = pbuf_alloc(PBUF_RAW, IP_HLEN + TCP_HLEN, PBUF_RAM);
+  if (p == NULL) {
+    printf("FAIL: pbuf_alloc\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(p->payload, 0, p->len);
+  iphdr = (struct ip_hdr *)p->payload;
+  IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+  IPH_LEN_SET(iphdr, lwip_htons(IP_HLEN + TCP_HLEN));
+  IPH_TTL_SET(iphdr, 64);
+  IPH_PROTO_SET(iphdr, IP_PROTO_TCP);
+  bench_remote_ip(i, &src);
+  ip4_addr_copy(iphdr->src, src);
+  ip4_addr_copy(iphdr->dest, *netif_ip4_addr(&bench_netif));
+
+  tcphdr = (struct tcp_hdr *)((u8_t *)p->payload + IP_HLEN);
+  tcphdr->src = lwip_htons((u16_t)(BENCH_REMOTE_PORT + i));
+  tcphdr->dest = lwip_htons((u16_t)(BENCH_LOCAL_PORT + (i % BENCH_LISTENERS)));
+  tcphdr->seqno = lwip_htonl(seqno);
+  tcphdr->ackno = lwip_htonl(ackno);
+  TCPH_HDRLEN_FLAGS_SET(tcphdr, TCP_HLEN / 4, flags);
+  tcphdr->wnd = lwip_htons(TCP_WND);
+
+  ip4_input(p, &bench_netif);
+}
+
+static int
+bench_list_len(struct tcp_pcb *list)
+{
+  int n = 0;
+
+  for (; list != NULL; list = list->next) {
+    n++;
+  }
+  return n;
+}
+
+#if TCP_PCB_HASH
+/* list上的每个pcb在table中恰好出现一次，而且在自己的哈希值对应的链上；table中没有list以外的pcb */
+static void
+bench_check_table(const char *name, struct tcp_pcb *list, struct tcp_pcb **table, int size, int listen)
+{
+  struct tcp_pcb *pcb, *h;
+  int idx, found, entries = 0;
+
+  for (idx = 0; idx < size; idx++) {
+    for (h = table[idx]; h != NULL; h = h->hash_next) {
+      entries++;
+      if (entries > 100000) {
+        printf("FAIL %s: loop in hash chain %d\n", name, idx);
+        bench_fail++;
+        return;
+      }
+    }
+  }
+  if (entries != bench_list_len(list)) {
+    printf("FAIL %s: %d pcbs on the list, %d on the hash chains\n", name, bench_list_len(list), entries);
+    bench_fail++;
+  }
+
+  for (pcb = list; pcb != NULL; pcb = pcb->next) {
+    found = 0;
+    for (idx = 0; idx < size; idx++) {
+      for (h = table[idx]; h != NULL; h = h->hash_next) {
+        if (h == pcb) {
+          found++;
+          if (idx != (listen ? TCP_LISTEN_HASH_IDX(pcb->local_port) :
+                      tcp_pcb_hash_idx(&pcb->remote_ip, pcb->local_port, pcb->remote_port))) {
+            printf("FAIL %s: pcb %p on the wrong chain %d\n", name, (void *)pcb, idx);
+            bench_fail++;
+          }
+        }
+      }
+    }
+    if (found != 1) {
+      printf("FAIL %s: pcb %p found %d times on the hash chains\n", name, (void *)pcb, found);
+      bench_fail++;
+    }
+  }
+}
+#endif /* TCP_PCB_HASH */
+
+static void
+bench_check(const char *step)
+{
+#if TCP_PCB_HASH
+  static struct tcp_pcb *listen_table[TCP_LISTEN_HASH_SIZE];
+  long fail = bench_fail;
+  int idx;
+
+  for (idx = 0; idx < TCP_LISTEN_HASH_SIZE; idx++) {
+    listen_table[idx] = tcp_listen_hash[idx].pcbs;
+  }
+  bench_check_table("active", tcp_active_pcbs, tcp_active_hash, TCP_PCB_HASH_SIZE, 0);
+  bench_check_table("time-wait", tcp_tw_pcbs, tcp_tw_hash, TCP_PCB_HASH_SIZE, 0);
+  bench_check_table("listen", tcp_listen_pcbs.pcbs, listen_table, TCP_LISTEN_HASH_SIZE, 1);
+  if (bench_fail != fail) {
+    printf("     after: %s\n", step);
+  }
+#else /* TCP_PCB_HASH */
+  LWIP_UNUSED_ARG(step);
+#endif /* TCP_PCB_HASH */
+}
+
+static void
+bench_expect(const char *step, int active, int tw)
+{
+  int a = bench_list_len(tcp_active_pcbs);
+  int t = bench_list_len(tcp_tw_pcbs);
+
+  if ((a != active) || (t != tw)) {
+    printf("FAIL %s: %d active (expected %d), %d time-wait (expected %d)\n", step, a, active, t, tw);
+    bench_fail++;
+  }
+  bench_check(step);
+}
+
+/* 对端发SYN，再对SYN-ACK回ACK。新pcb由TCP_REG_ACTIVE放在tcp_active_pcbs的表头 */
+static struct tcp_pcb *
+bench_connect(int i, int complete)
+{
+  struct tcp_pcb *pcb;
+
+  bench_input(i, bench_peer_seq, 0, TCP_SYN);
+  pcb = tcp_active_pcbs;
+  if ((pcb == NULL) || (pcb->state != SYN_RCVD) || (pcb->remote_port != BENCH_REMOTE_PORT + i)) {
+    printf("FAIL: no SYN_RCVD pcb for connection %d\n", i);
+    exit(EXIT_FAILURE);
+  }
+  if (complete) {
+    bench_input(i, pcb->rcv_nxt, pcb->snd_nxt, TCP_ACK);
+    if (pcb->state != ESTABLISHED) {
+      printf("FAIL: connection %d not established\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+  return pcb;
+}
+
+static double
+bench_elapsed_ns(const struct timespec *t0, const struct timespec *t1)
+{
+  return (double)(t1->tv_sec - t0->tv_sec) * 1e9 + (double)(t1->tv_nsec - t0->tv_nsec);
+}
+
+int
+main(void)
+{
+  struct tcp_pcb_listen *listeners[BENCH_LISTENERS];
+  struct tcp_pcb *pcb;
+  ip4_addr_t ip, mask, gw;
+  struct timespec t0, t1;
+  int i, r, n, active;
+  err_t err;
+
+  lwip_init();
+  IP4_ADDR(&ip, 192, 168, 1, 122);
+  IP4_ADDR(&mask, 255, 255, 255, 0);
+  IP4_ADDR(&gw, 192, 168, 1, 1);
+  netif_add(&bench_netif, &ip, &mask, &gw, NULL, bench_netif_init, ip4_input);
+  netif_set_default(&bench_netif);
+  netif_set_up(&bench_netif);
+  netif_set_link_up(&bench_netif);
+
+  for (i = 0; i < BENCH_LISTENERS; i++) {
+    pcb = tcp_new();
+    if ((pcb == NULL) || (tcp_bind(pcb, IP_ADDR_ANY, (u16_t)(BENCH_LOCAL_PORT + i)) != ERR_OK)) {
+      printf("FAIL: cannot bind listener %d\n", i);
+      return EXIT_FAILURE;
+    }
+    listeners[i] = (struct tcp_pcb_listen *)tcp_listen_with_backlog_and_err(pcb, TCP_DEFAULT_LISTEN_BACKLOG, &err);
+    if (listeners[i] == NULL) {
+      printf("FAIL: tcp_listen %d\n", i);
+      return EXIT_FAILURE;
+    }
+    tcp_accept((struct tcp_pcb *)listeners[i], bench_accept);
+  }
+  bench_check("tcp_listen");
+
+  for (i = 0; i < BENCH_CONNS; i++) {
+    bench_conns[i] = bench_connect(i, 1);
+  }
+  bench_expect("connect", BENCH_CONNS, 0);
+  if (bench_accepted != BENCH_CONNS) {
+    printf("FAIL: %u connections accepted\n", (unsigned)bench_accepted);
+    bench_fail++;
+  }
+
+  /* 计时：轮流给每个连接发一个不带数据的ACK，每个报文段都要找一次pcb。
+     轮流访问时移到表头的缓存不起作用，不用哈希时每次要走过大半个链表 */
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (r = 0; r < BENCH_ROUNDS; r++) {
+    for (i = 0; i < BENCH_CONNS; i++) {
+      bench_input(i, bench_conns[i]->rcv_nxt, bench_conns[i]->snd_nxt, TCP_ACK);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  printf("tcp_input: TCP_PCB_HASH=%d, %d connections, %d segments, %.1f ns/segment\n",
+         TCP_PCB_HASH, BENCH_CONNS, BENCH_ROUNDS * BENCH_CONNS,
+         bench_elapsed_ns(&t0, &t1) / (BENCH_ROUNDS * BENCH_CONNS));
+  bench_expect("tcp_input", BENCH_CONNS, 0);
+
+  /* 按i % 5分组拆除连接：
+     0: 本端关闭，对端FIN+ACK -> TIME-WAIT(active -> tw)，之后由tcp_slowtmr删除
+     1: 本端关闭，对端只回ACK -> FIN-WAIT-2，由tcp_slowtmr超时删除
+     2: 对端FIN -> CLOSE-WAIT，tcp_recv_null关闭 -> LAST-ACK，对端ACK后删除
+     3: 对端RST，删除
+     4: 一半tcp_abort()，一半保持连接 */
+  active = BENCH_CONNS;
+  n = 0;
+  for (i = 0; i < BENCH_CONNS; i++) {
+    pcb = bench_conns[i];
+    switch (i % 5) {
+      case 0:
+        tcp_close(pcb);
+        bench_input(i, pcb->rcv_nxt, pcb->snd_nxt, TCP_FIN | TCP_ACK);
+        if (pcb->state != TIME_WAIT) {
+          printf("FAIL: connection %d in state %d, expected TIME_WAIT\n", i, pcb->state);
+          bench_fail++;
+        }
+        active--;
+        n++;
+        break;
+      case 1:
+        tcp_close(pcb);
+        bench_input(i, pcb->rcv_nxt, pcb->snd_nxt, TCP_ACK);
+        break;
+      case 2:
+        bench_input(i, pcb->rcv_nxt, pcb->snd_nxt, TCP_FIN | TCP_ACK);
+        if (pcb->state != LAST_ACK) {
+          printf("FAIL: connection %d in state %d, expected LAST_ACK\n", i, pcb->state);
+          bench_fail++;
+        }
+        bench_input(i, pcb->rcv_nxt, pcb->snd_nxt, TCP_ACK);
+        bench_conns[i] = NULL;
+        active--;
+        break;
+      case 3:
+        bench_input(i, pcb->rcv_nxt, pcb->snd_nxt, TCP_RST | TCP_ACK);
+        bench_conns[i] = NULL;
+        active--;
+        break;
+      default:
+        if (i & 1) {
+          tcp_abort(pcb);
+          bench_conns[i] = NULL;
+          active--;
+        }
+        break;
+    }
+  }
+  bench_expect("close", active, n);
+
+  /* 半开连接停在SYN-RCVD，和FIN-WAIT-2一样由tcp_slowtmr超时删除 */
+  for (i = 0; i < BENCH_HALF_OPEN; i++) {
+    bench_connect(BENCH_CONNS + i, 0);
+  }
+  bench_check("half open");
+
+  /* 走完2*TCP_MSL，TIME-WAIT、FIN-WAIT-2和SYN-RCVD都应该被tcp_slowtmr删除 */
+  for (r = 0; r <= (int)((2 * TCP_MSL) / TCP_SLOW_INTERVAL) + 10; r++) {
+    bench_ms += TCP_SLOW_INTERVAL;
+    tcp_slowtmr();
+    if ((r % 16) == 0) {
+      bench_check("tcp_slowtmr");
+    }
+  }
+  n = 0;
+  for (i = 0; i < BENCH_CONNS; i++) {
+    if ((i % 5 == 4) && !(i & 1)) {
+      n++;
+    }
+  }
+  bench_expect("tcp_slowtmr", n, 0);
+
+  for (i = 0; i < BENCH_CONNS; i++) {
+    if ((i % 5 == 4) && (bench_conns[i] != NULL)) {
+      tcp_abort(bench_conns[i]);
+    }
+  }
+  for (i = 0; i < BENCH_LISTENERS; i++) {
+    tcp_close((struct tcp_pcb *)listeners[i]);
+  }
+  bench_expect("tcp_abort/tcp_close", 0, 0);
+  if (tcp_listen_pcbs.pcbs != NULL) {
+    printf("FAIL: listen pcbs left\n");
+    bench_fail++;
+  }
+
+  printf("tcp_pcb: TCP_PCB_HASH=%d, %s\n", TCP_PCB_HASH, (bench_fail == 0) ? "consistent" : "FAILED");
+  return (bench_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file
+ * 主机测试用的lwIP配置，NO_SYS=1，不依赖uCOS和HAL库
+ *
+ */
+
+#ifndef LWIP_TEST_LWIPOPTS_H
+#define LWIP_TEST_LWIPOPTS_H
+
+#define NO_SYS                          1
+#define SYS_LIGHTWEIGHT_PROT            0
+#define LWIP_NETCONN                    0
+#define LWIP_SOCKET                     0
+
+/* arch/cc.h把LWIP_CHKSUM设为lwip_cm4_chksum，这里让inet_chksum.c仍然编译lwip_standard_chksum作为参考 */
+#define LWIP_CHKSUM_ALGORITHM           2
+
+/* 内存和内存池都用malloc，连接数只受主机内存限制 */
+#define MEM_LIBC_MALLOC                 1
+#define MEMP_MEM_MALLOC                 1
+#define MEM_ALIGNMENT                   8
+#define MEMP_NUM_TCP_PCB                1200
+#define MEMP_NUM_TCP_PCB_LISTEN         16
+
+/* 只保留IPv4、ARP、UDP和TCP，测试直接把报文交给ip4_input()或etharp_input() */
+#define LWIP_ICMP                       0
+#define LWIP_RAW                        0
+#define LWIP_UDP                        1
+#define SO_REUSE                        1
+#define LWIP_IGMP                       0
+#define LWIP_DHCP                       0
+#define LWIP_DNS                        0
+#define LWIP_IPV6                       0
+#define IP_REASSEMBLY                   0
+#define IP_FRAG                         0
+#define LWIP_STATS                      0
+
+/* 测试构造的报文不填校验和，接收时不检查 */
+#define CHECKSUM_CHECK_IP               0
+#define CHECKSUM_CHECK_TCP              0
+#define CHECKSUM_CHECK_UDP              0
+
+#endif /* LWIP_TEST_LWIPOPTS_H */
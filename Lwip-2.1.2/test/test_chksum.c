@@ -0,0 +1,142 @@
+/**
+ * @file
+ * arch/chksum.c的主机参考测试：lwip_cm4_chksum()和lwip_copy_chksum()的结果必须和
+ * lwip_standard_chksum()相同，lwip_copy_chksum()还要逐字节复制正确且不越界写
+ *
+ * 主机上编译的是chksum.c中的C实现(chksum_words/copy_chksum_words)，
+ * armcc的__asm实现只能在开发板上验证
+ *
+ */
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/inet_chksum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+u16_t lwip_standard_chksum(const void *dataptr, int len);
+
+#define TEST_MAX_LEN      1536      /* 比以太网最大帧长一些 */
+#define TEST_MAX_OFFSET   8         /* 源和目的地址都覆盖0~7的所有对齐情况 */
+#define TEST_GUARD        16        /* 目的缓冲区前后的保护字节 */
+#define TEST_GUARD_BYTE   0xA5
+#define TEST_ITERATIONS   200000L
+
+static u8_t src_buf[TEST_MAX_OFFSET + TEST_MAX_LEN];
+static u8_t dst_buf[TEST_GUARD + TEST_MAX_OFFSET + TEST_MAX_LEN + TEST_GUARD];
+
+static long test_count;
+static long test_fail;
+
+static void
+test_report(const char *what, int soff, int doff, int len, u16_t got, u16_t expect)
+{
+  test_fail++;
+  if (test_fail <= 10) {
+    printf("FAIL %s: src offset %d, dst offset %d, len %d: got 0x%04x, expected 0x%04x\n",
+           what, soff, doff, len, got, expect);
+  }
+}
+
+/* 检查一次求和和一次复制求和，doff < 0时只检查求和 */
+static void
+test_one(int soff, int doff, int len)
+{
+  const u8_t *src = src_buf + soff;
+  u8_t *dst;
+  u16_t expect, got;
+  int i;
+
+  test_count++;
+  expect = lwip_standard_chksum(src, len);
+  got = lwip_cm4_chksum(src, len);
+  if (got != expect) {
+    test_report("lwip_cm4_chksum", soff, -1, len, got, expect);
+  }
+
+  if (doff < 0) {
+    return;
+  }
+
+  memset(dst_buf, TEST_GUARD_BYTE, sizeof(dst_buf));
+  dst = dst_buf + TEST_GUARD + doff;
+  got = lwip_copy_chksum(dst, src, (u16_t)len);
+  if (got != expect) {
+    test_report("lwip_copy_chksum", soff, doff, len, got, expect);
+  }
+  if (memcmp(dst, src, (size_t)len) != 0) {
+    test_report("lwip_copy_chksum data", soff, doff, len, 0, 0);
+  }
+  for (i = 0; i < TEST_GUARD + doff; i++) {
+    if (dst_buf[i] != TEST_GUARD_BYTE) {
+      test_report("lwip_copy_chksum underrun", soff, doff, len, dst_buf[i], TEST_GUARD_BYTE);
+      break;
+    }
+  }
+  for (i = TEST_GUARD + doff + len; i < (int)sizeof(dst_buf); i++) {
+    if (dst_buf[i] != TEST_GUARD_BYTE) {
+      test_report("lwip_copy_chksum overrun", soff, doff, len, dst_buf[i], TEST_GUARD_BYTE);
+      break;
+    }
+  }
+}
+
+/* 短数据覆盖所有的源/目的对齐组合，首尾的单字节和半字处理都会走到 */
+static void
+test_all_alignments(int max_len)
+{
+  int soff, doff, len;
+
+  for (soff = 0; soff < TEST_MAX_OFFSET; soff++) {
+    for (doff = 0; doff < TEST_MAX_OFFSET; doff++) {
+      for (len = 0; len <= max_len; len++) {
+        test_one(soff, doff, len);
+      }
+    }
+  }
+}
+
+static void
+test_fill(int pattern)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof(src_buf); i++) {
+    src_buf[i] = (u8_t)((pattern < 0) ? rand() : pattern);
+  }
+}
+
+int
+main(int argc, char **argv)
+{
+  long iterations = (argc > 1) ? atol(argv[1]) : TEST_ITERATIONS;
+  long n;
+
+  srand(1);
+
+  /* 全0和全0xFF：反码和的两种零值，最容易暴露进位处理的错误 */
+  test_fill(0x00);
+  test_all_alignments(64);
+  test_one(0, 0, TEST_MAX_LEN);
+  test_fill(0xFF);
+  test_all_alignments(64);
+  test_one(0, 0, TEST_MAX_LEN);
+  test_one(1, 3, TEST_MAX_LEN - 1);
+
+  test_fill(-1);
+  test_all_alignments(64);
+
+  /* 随机数据、随机对齐、随机长度，每隔一段时间换一次数据 */
+  for (n = 0; n < iterations; n++) {
+    if ((n & 1023) == 0) {
+      test_fill(-1);
+    }
+    test_one(rand() % TEST_MAX_OFFSET, (n & 1) ? (rand() % TEST_MAX_OFFSET) : -1,
+             rand() % (TEST_MAX_LEN + 1));
+  }
+
+  printf("chksum: %ld cases, %ld failed\n", test_count, test_fail);
+  return (test_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
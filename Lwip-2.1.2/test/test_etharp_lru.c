@@ -0,0 +1,181 @@
+/**
+ * @file
+ * ETHARP_TABLE_HASH的主机测试：组内表项用完时，新地址应该替换组内最久没有使用的表项。
+ * etharp_output()的稳定表项查找和缓存表项(etharp_cached_entry)命中都要算作使用，
+ * 否则被替换的会是刚刚用过的表项
+ *
+ * 以ETHARP_TABLE_HASH=1、ARP_TABLE_SIZE=8编译，ETHARP_TABLE_HASH_WAYS为默认的4，共两组
+ *
+ */
+
+#include "lwip/opt.h"
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/etharp.h"
+#include "netif/ethernet.h"
+#include "lwip/prot/etharp.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/iana.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !ETHARP_TABLE_HASH || (ARP_TABLE_SIZE != 2 * ETHARP_TABLE_HASH_WAYS)
+#error "build with -DETHARP_TABLE_HASH=1 -DARP_TABLE_SIZE=8"
+#endif
+
+#define TEST_ADDRS  (ETHARP_TABLE_HASH_WAYS + 2)
+
+static struct netif test_netif;
+static ip4_addr_t test_addr[TEST_ADDRS];
+static long test_fail;
+
+u32_t
+sys_now(void)
+{
+  return 0;
+}
+
+static err_t
+test_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  return ERR_OK;
+}
+
+static err_t
+test_netif_init(struct netif *netif)
+{
+  static const u8_t mac[ETH_HWADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+
+  netif->output = etharp_output;
+  netif->linkoutput = test_linkoutput;
+  netif->mtu = 1500;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  memcpy(netif->hwaddr, mac, ETH_HWADDR_LEN);
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET;
+  return ERR_OK;
+}
+
+/* 和etharp.c中etharp_set_first()相同的哈希，只用来挑出落在同一组的地址 */
+static int
+test_set(const ip4_addr_t *ip)
+{
+  u32_t h = ip4_addr_get_u32(ip) * 2654435761UL;
+  return (int)((h >> 16) % (ARP_TABLE_SIZE / ETHARP_TABLE_HASH_WAYS));
+}
+
+/* 对端发来ARP应答，建立或刷新它的表项 */
+static void
+test_arp_reply(int n)
+{
+  struct pbuf *p;
+  struct etharp_hdr *hdr;
+
+  p = pbuf_alloc(PBUF_RAW, SIZEOF_ETHARP_HDR, PBUF_RAM);
+  if (p == NULL) {
+    printf("FAIL: pbuf_alloc\n");
+    exit(EXIT_FAILURE);
+  }
+  hdr = (struct etharp_hdr *)p->payload;
+  memset(hdr, 0, SIZEOF_ETHARP_HDR);
+  hdr->hwtype = PP_HTONS(LWIP_IANA_HWTYPE_ETHERNET);
+  hdr->proto = PP_HTONS(ETHTYPE_IP);
+  hdr->hwlen = ETH_HWADDR_LEN;
+  hdr->protolen = sizeof(ip4_addr_t);
+  hdr->opcode = PP_HTONS(ARP_REPLY);
+  hdr->shwaddr.addr[0] = 0x02;
+  hdr->shwaddr.addr[5] = (u8_t)(0x10 + n);
+  IPADDR_WORDALIGNED_COPY_FROM_IP4_ADDR_T(&hdr->sipaddr, &test_addr[n]);
+  memcpy(&hdr->dhwaddr, test_netif.hwaddr, ETH_HWADDR_LEN);
+  IPADDR_WORDALIGNED_COPY_FROM_IP4_ADDR_T(&hdr->dipaddr, netif_ip4_addr(&test_netif));
+  etharp_input(p, &test_netif);
+}
+
+/* 给test_addr[n]发一个IP包 */
+static void
+test_output(int n)
+{
+  struct pbuf *p = pbuf_alloc(PBUF_IP, 20, PBUF_RAM);
+
+  if (p == NULL) {
+    printf("FAIL: pbuf_alloc\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(p->payload, 0, p->len);
+  if (etharp_output(&test_netif, p, &test_addr[n]) != ERR_OK) {
+    printf("FAIL: etharp_output %d\n", n);
+    test_fail++;
+  }
+  pbuf_free(p);
+}
+
+static void
+test_expect(const char *step, int n, int cached)
+{
+  struct eth_addr *eth;
+  const ip4_addr_t *ip;
+  int found = etharp_find_addr(&test_netif, &test_addr[n], &eth, &ip) >= 0;
+
+  if (found != cached) {
+    printf("FAIL %s: address %d %s\n", step, n, cached ? "was evicted" : "is still cached");
+    test_fail++;
+  }
+}
+
+int
+main(void)
+{
+  ip4_addr_t ip, mask, gw;
+  u32_t host;
+  int n = 0;
+
+  lwip_init();
+  IP4_ADDR(&ip, 192, 168, 1, 122);
+  IP4_ADDR(&mask, 255, 255, 255, 0);
+  IP4_ADDR(&gw, 192, 168, 1, 1);
+  netif_add(&test_netif, &ip, &mask, &gw, NULL, test_netif_init, ethernet_input);
+  netif_set_default(&test_netif);
+  netif_set_up(&test_netif);
+  netif_set_link_up(&test_netif);
+
+  /* 挑出同一组的TEST_ADDRS个地址，称为A、B、C、D、E、F */
+  for (host = 2; (host < 255) && (n < TEST_ADDRS); host++) {
+    IP4_ADDR(&test_addr[n], 192, 168, 1, host);
+    if ((host != 122) && (test_set(&test_addr[n]) == 0)) {
+      n++;
+    }
+  }
+  if (n < TEST_ADDRS) {
+    printf("FAIL: not enough addresses in set 0\n");
+    return EXIT_FAILURE;
+  }
+
+  /* A、B、C、D占满一组，D的查找让缓存表项离开A，
+     再给A发包(稳定表项查找命中)，最久没用的就是B */
+  for (n = 0; n < ETHARP_TABLE_HASH_WAYS; n++) {
+    test_arp_reply(n);
+  }
+  test_output(3);
+  test_output(0);
+  test_arp_reply(4);
+  test_expect("stable entry hit", 1, 0);
+  test_expect("stable entry hit", 0, 1);
+
+  /* 组内现在是A、C、D、E。给C发包让缓存表项指向C，A、D、E再刷新，
+     然后给C发包(缓存表项命中)，最久没用的就是A */
+  test_output(2);
+  test_arp_reply(0);
+  test_arp_reply(3);
+  test_arp_reply(4);
+  test_output(2);
+  test_arp_reply(5);
+  test_expect("cached entry hit", 0, 0);
+  test_expect("cached entry hit", 2, 1);
+  test_expect("cached entry hit", 3, 1);
+  test_expect("cached entry hit", 4, 1);
+  test_expect("cached entry hit", 5, 1);
+
+  printf("etharp_lru: %s\n", (test_fail == 0) ? "least recently used entry recycled" : "FAILED");
+  return (test_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file
+ * UDP_PCB_HASH的主机测试：多个设置了SO_REUSEADDR的pcb随机绑定、重新绑定到少数几个端口，
+ * 随机连接到几个对端或者断开连接。每一步之后从每个对端和一个没有pcb连接的地址给每个端口
+ * 发一个数据报，收到它的必须是按udp_pcbs顺序选出的pcb：第一个完全匹配(已连接到该对端)的pcb，
+ * 没有的话是第一个未连接的pcb，也就是和不使用哈希时udp_input()的选择相同。
+ * 已连接pcb收到数据报后会被移到前面，这个顺序也要和不使用哈希时相同
+ *
+ * 同一个源文件分别以UDP_PCB_HASH=0和1编译，两者输出的接收者摘要(digest)应该相同
+ *
+ */
+
+#include "lwip/opt.h"
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/ip4.h"
+#include "lwip/udp.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/udp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_PCBS         24
+#define TEST_PORTS        5       /* 端口少于pcb数，每个端口上有多个pcb */
+#define TEST_LOCAL_PORT   7000
+#define TEST_STEPS        2000
+#define TEST_REMOTES      3       /* 可以连接的对端，另外还有一个没有pcb连接的源地址 */
+#define TEST_REMOTE_PORT  40000
+
+static struct netif test_netif;
+static struct udp_pcb *test_pcbs[TEST_PCBS];
+static struct udp_pcb *test_received;
+static long test_fail;
+static u32_t test_digest;
+
+u32_t
+sys_now(void)
+{
+  return 0;
+}
+
+static err_t
+test_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  return ERR_OK;
+}
+
+static err_t
+test_netif_init(struct netif *netif)
+{
+  netif->output = test_output;
+  netif->mtu = 1500;
+  return ERR_OK;
+}
+
+static void
+test_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  test_received = pcb;
+  pbuf_free(p);
+}
+
+static void
+test_remote(int r, ip_addr_t *addr)
+{
+  IP_ADDR4(addr, 10, 0, 0, (u8_t)(r + 1));
+}
+
+/* 构造一个从第r个对端发到本机port端口的IPv4 UDP数据报，交给ip4_input() */
+static void
+test_input(u16_t port, int r)
+{
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  struct udp_hdr *udphdr;
+  ip4_addr_t src;
+
+  p = pbuf_alloc(PBUF_RAW, IP_HLEN + UDP_HLEN + 4, PBUF_RAM);
+  if (p == NULL) {
+    printf("FAIL: pbuf_alloc\n");
+    exit(EXIT_FAILURE);
+  }
+  memset(p->payload, 0, p->len);
+  iphdr = (struct ip_hdr *)p->payload;
+  IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+  IPH_LEN_SET(iphdr, lwip_htons(IP_HLEN + UDP_HLEN + 4));
+  IPH_TTL_SET(iphdr, 64);
+  IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+  IP4_ADDR(&src, 10, 0, 0, (u8_t)(r + 1));
+  ip4_addr_copy(iphdr->src, src);
+  ip4_addr_copy(iphdr->dest, *netif_ip4_addr(&test_netif));
+
+  udphdr = (struct udp_hdr *)((u8_t *)p->payload + IP_HLEN);
+  udphdr->src = lwip_htons((u16_t)(TEST_REMOTE_PORT + r));
+  udphdr->dest = lwip_htons(port);
+  udphdr->len = lwip_htons(UDP_HLEN + 4);
+
+  ip4_input(p, &test_netif);
+}
+
+/* 按udp_pcbs的顺序选出应该收到第r个对端发到port的数据报的pcb(所有pcb都绑定IP_ADDR_ANY) */
+static struct udp_pcb *
+test_expected(u16_t port, int r)
+{
+  struct udp_pcb *pcb, *uncon_pcb = NULL;
+  ip_addr_t src;
+
+  test_remote(r, &src);
+  for (pcb = udp_pcbs; pcb != NULL; pcb = pcb->next) {
+    if (pcb->local_port != port) {
+      continue;
+    }
+    if (((pcb->flags & UDP_FLAGS_CONNECTED) == 0) && (uncon_pcb == NULL)) {
+      uncon_pcb = pcb;
+    }
+    if ((pcb->remote_port == TEST_REMOTE_PORT + r) &&
+        (ip_addr_isany_val(pcb->remote_ip) || ip_addr_cmp(&pcb->remote_ip, &src))) {
+      return pcb;
+    }
+  }
+  return uncon_pcb;
+}
+
+static void
+test_check(int step)
+{
+  struct udp_pcb *pcb;
+  u16_t port;
+  int r, i;
+
+  for (port = TEST_LOCAL_PORT; port < TEST_LOCAL_PORT + TEST_PORTS; port++) {
+    for (r = 0; r <= TEST_REMOTES; r++) {
+      pcb = test_expected(port, r);
+      test_received = NULL;
+      test_input(port, r);
+      if (test_received != pcb) {
+        test_fail++;
+        if (test_fail <= 10) {
+          printf("FAIL step %d, port %u, remote %d: received by %p, expected %p\n",
+                 step, (unsigned)port, r, (void *)test_received, (void *)pcb);
+        }
+      }
+      for (i = 0; (i < TEST_PCBS) && (test_pcbs[i] != test_received); i++) {
+      }
+      test_digest = test_digest * 31 + (u32_t)i;
+    }
+  }
+}
+
+int
+main(void)
+{
+  ip4_addr_t ip, mask, gw;
+  ip_addr_t remote;
+  int i, step, op, r;
+
+  lwip_init();
+  IP4_ADDR(&ip, 192, 168, 1, 122);
+  IP4_ADDR(&mask, 255, 255, 255, 0);
+  IP4_ADDR(&gw, 192, 168, 1, 1);
+  netif_add(&test_netif, &ip, &mask, &gw, NULL, test_netif_init, ip4_input);
+  netif_set_default(&test_netif);
+  netif_set_up(&test_netif);
+  netif_set_link_up(&test_netif);
+
+  srand(1);
+  for (i = 0; i < TEST_PCBS; i++) {
+    test_pcbs[i] = udp_new();
+    ip_set_option(test_pcbs[i], SOF_REUSEADDR);
+    udp_recv(test_pcbs[i], test_recv, NULL);
+  }
+
+  /* 随机地第一次绑定、重新绑定到另一个端口、连接到一个对端、断开连接、删除后重新创建 */
+  for (step = 0; step < TEST_STEPS; step++) {
+    i = rand() % TEST_PCBS;
+    op = rand() % 16;
+    if (op < 2) {
+      udp_remove(test_pcbs[i]);
+      test_pcbs[i] = udp_new();
+      ip_set_option(test_pcbs[i], SOF_REUSEADDR);
+      udp_recv(test_pcbs[i], test_recv, NULL);
+    } else if ((op < 5) && (test_pcbs[i]->local_port != 0)) {
+      r = rand() % TEST_REMOTES;
+      test_remote(r, &remote);
+      if (udp_connect(test_pcbs[i], &remote, (u16_t)(TEST_REMOTE_PORT + r)) != ERR_OK) {
+        printf("FAIL step %d: udp_connect\n", step);
+        test_fail++;
+      }
+    } else if (op < 6) {
+      udp_disconnect(test_pcbs[i]);
+    } else if (udp_bind(test_pcbs[i], IP4_ADDR_ANY, (u16_t)(TEST_LOCAL_PORT + rand() % TEST_PORTS)) != ERR_OK) {
+      printf("FAIL step %d: udp_bind\n", step);
+      test_fail++;
+    }
+    test_check(step);
+  }
+
+  printf("udp_order: UDP_PCB_HASH=%d, %d steps, %ld failed, digest 0x%08lx\n",
+         UDP_PCB_HASH, TEST_STEPS, test_fail, (unsigned long)test_digest);
+  return (test_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
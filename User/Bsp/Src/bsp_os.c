@@ -54,12 +54,15 @@
 #endif
 
 #if (OS_CFG_DYN_TICK_EN == DEF_ENABLED)
-#define  TIMER_COUNT_HZ             (10000u)                    /* Timer counts per second.                             */
-#define  TIMER_TO_OSTICK(count)     (((CPU_INT64U)(count)  * OS_CFG_TICK_RATE_HZ) /      TIMER_COUNT_HZ)
-#define  OSTICK_TO_TIMER(ostick)    (((CPU_INT64U)(ostick) * TIMER_COUNT_HZ)      / OS_CFG_TICK_RATE_HZ)
+#define  TIMER_COUNT_HZ             (1000000u)                  /* Timer counts per second.                             */
+#define  TIMER_COUNT_PER_TICK       (TIMER_COUNT_HZ / OS_CFG_TICK_RATE_HZ)
 
-                                                                /* The max timer count should end on a 1 tick boundary. */
-#define  TIMER_COUNT_MAX            (DEF_INT_32U_MAX_VAL - (DEF_INT_32U_MAX_VAL % OSTICK_TO_TIMER(1u)))
+                                                                /* Longest step, keeps count differences below 2^31.    */
+#define  TIMER_TICK_MAX             (0x7FFFFFFFu / TIMER_COUNT_PER_TICK)
+
+#if (OS_CFG_TICK_RATE_HZ != 1000u)
+#error  "bsp_os.c: HAL_GetTick() in dynamic tick mode requires OS_CFG_TICK_RATE_HZ == 1000"
+#endif
 #endif
 
 
@@ -67,13 +70,22 @@
 *********************************************************************************************************
 *                                           LOCAL VARIABLES
 *
-* Note(s) : (1) BSP_OS_UnTick is used to keep track of any ticks that happen before the OS is ready to
-*               awake some tasks.
+* Note(s) : (1) TIM5 counts freely over its full 32-bit range. TickBase is the count at which OSTickCtr
+*               was last brought up to date, and the next tick interrupt is a compare match on channel 1
+*               at TickBase + TickDelta ticks. Time is never lost by stopping or reloading the counter.
+*
+*           (2) TickElapsed holds the value last returned by OS_DynTickGet(). The kernel adds exactly
+*               that many ticks to OSTickCtr before calling OS_DynTickSet(), so OS_DynTickSet() moves
+*               TickBase forward by the same amount.
 *********************************************************************************************************
 */
 
 #if (OS_CFG_DYN_TICK_EN == DEF_ENABLED)
-static  OS_TICK  TickDelta = 0u;                                /* Stored in OS Tick units.                             */
+static  OS_TICK     TickDelta   = 0u;                           /* Stored in OS Tick units.                             */
+static  OS_TICK     TickElapsed = 0u;                           /* See Note #2.                                         */
+static  CPU_INT32U  TickBase    = 0u;                           /* Stored in timer counts, see Note #1.                 */
+static  CPU_INT32U  HalTickOffset = 0u;                         /* uwTick value when the OS took over HAL_GetTick().    */
+static  CPU_BOOLEAN HalTickFromOS = DEF_NO;
 
 TIM_HandleTypeDef  TimHandle;
 #endif
@@ -156,6 +168,16 @@ void  BSP_OS_TickEnable (void)
     CPU_REG_SYST_CSR |= (CPU_REG_SYST_CSR_TICKINT |             /* Enables SysTick exception request                    */
                          CPU_REG_SYST_CSR_ENABLE);              /* Enables SysTick counter                              */
 #else
+    OS_ERR  os_err;
+    CPU_SR_ALLOC();
+
+
+    CPU_CRITICAL_ENTER();                                       /* HAL time base follows the OS tick from now on, ...   */
+    HalTickOffset = uwTick - (CPU_INT32U)OSTimeGet(&os_err);    /* ... TIM7 no longer needs to interrupt every 1ms.     */
+    HalTickFromOS = DEF_YES;
+    HAL_SuspendTick();
+    CPU_CRITICAL_EXIT();
+
     BSP_IntEnable(INT_ID_TIM5);                                 /* Enable Timer interrupt.                              */
     HAL_TIM_Base_Start(&TimHandle);                             /* Start the Timer count generation.                    */
 #endif
@@ -184,9 +206,47 @@ void  BSP_OS_TickDisable (void)
 #else
     HAL_TIM_Base_Stop(&TimHandle);                              /* Stop the Timer count generation.                     */
     BSP_IntDisable(INT_ID_TIM5);                                /* Disable Timer interrupt.                             */
+
+    if (HalTickFromOS == DEF_YES) {                             /* Give the HAL time base back to TIM7.                 */
+        HalTickFromOS = DEF_NO;
+        HAL_ResumeTick();
+    }
 #endif
 }
 
+
+#if (OS_CFG_DYN_TICK_EN == DEF_ENABLED)
+/*
+*********************************************************************************************************
+*                                            HAL_GetTick()
+*
+* Description : HAL time base in dynamic tick mode.
+*
+* Argument(s) : none.
+*
+* Return(s)   : Tick current value, in milliseconds.
+*
+* Caller(s)   : STM32Cube HAL driver files, HAL_Delay().
+*
+* Note(s)     : (1) Until BSP_OS_TickEnable() is called, the HAL keeps using uwTick incremented by TIM7.
+*                   Afterwards TIM7 is suspended so that it no longer wakes the CPU every millisecond,
+*                   and the tick is read from the OS, offset so that it continues from uwTick.
+*********************************************************************************************************
+*/
+
+uint32_t  HAL_GetTick (void)
+{
+    OS_ERR  os_err;
+
+
+    if (HalTickFromOS == DEF_YES) {
+        return ((uint32_t)OSTimeGet(&os_err) + HalTickOffset);
+    }
+
+    return (uwTick);
+}
+#endif
+
 #if 0
 /*
 *********************************************************************************************************
@@ -286,22 +346,23 @@ static  void  BSP_OS_DynamicTickInit (void)
     HAL_StatusTypeDef   hal_stat;
     RCC_ClkInitTypeDef  rcc_clk_cfg;
     CPU_INT32U          per_clk;
+    CPU_INT32U          flash_latency;
 
 
     __HAL_RCC_TIM5_CLK_ENABLE();                                /* Enable TIMER5 interface clock.                       */
 
-	__HAL_DBGMCU_FREEZE_TIM5();                                 /* Make sure TIMER5 is stop when core is halted.        */
+    __HAL_DBGMCU_FREEZE_TIM5();                                 /* Make sure TIMER5 is stop when core is halted.        */
     per_clk         = BSP_ClkFreqGet(CLK_ID_PCLK1);             /* Get TIMER5 clock frequency.                          */
 
-    HAL_RCC_GetClockConfig(&rcc_clk_cfg, 0);                    /* Obtain current clock configuration                   */
-	
+    HAL_RCC_GetClockConfig(&rcc_clk_cfg, &flash_latency);       /* Obtain current clock configuration                   */
+
                                                                 /* -------- INITIALIZE TIMER BASE CONFIGURATION ------- */
     if (rcc_clk_cfg.APB1CLKDivider == RCC_HCLK_DIV1) {          /* Configure the timer prescaler. See Note (1).         */
         TimHandle.Init.Prescaler = ((per_clk)      / TIMER_COUNT_HZ) - 1u ;
     } else {
         TimHandle.Init.Prescaler = ((per_clk * 2u) / TIMER_COUNT_HZ) - 1u ;
     }
-    TimHandle.Init.Period        = TIMER_COUNT_MAX;             /* Let timer run freely until the kernel sets a delay.  */
+    TimHandle.Init.Period        = DEF_INT_32U_MAX_VAL;         /* Free running, see 'LOCAL VARIABLES  Note #1'.        */
     TimHandle.Init.ClockDivision = 0u;
     TimHandle.Init.CounterMode   = TIM_COUNTERMODE_UP;
     TimHandle.Instance           = TIM5;
@@ -310,8 +371,13 @@ static  void  BSP_OS_DynamicTickInit (void)
         while(1u);                                              /* STOP if error                                        */
     }
 
-    HAL_TIM_Base_Start_IT(&TimHandle);                          /* Start the timer interrupt mode generation.           */
     __HAL_TIM_SET_COUNTER(&TimHandle, 0u);                      /* Reset the timer counter value                        */
+    TickBase    = 0u;
+    TickElapsed = 0u;
+    TickDelta   = TIMER_TICK_MAX;                               /* No delay requested yet.                              */
+    __HAL_TIM_SET_COMPARE(&TimHandle, TIM_CHANNEL_1, TickDelta * TIMER_COUNT_PER_TICK);
+    __HAL_TIM_CLEAR_IT(&TimHandle, TIM_IT_CC1 | TIM_IT_UPDATE);
+    __HAL_TIM_ENABLE_IT(&TimHandle, TIM_IT_CC1);                /* Counter is started by BSP_OS_TickEnable().           */
 
 #if 0                                                            /* ----------- SET INTERRUPT REQUEST HANDLER ---------- */
     BSP_IntVectSet(INT_ID_TIM5,
@@ -343,18 +409,18 @@ static  void  BSP_OS_DynamicTickInit (void)
 
 OS_TICK  OS_DynTickGet (void)
 {
-    CPU_INT32U  tmrcnt;
+    CPU_INT32U  elapsed;
 
+                                                                /* Whole ticks since OSTickCtr was last updated.        */
+    elapsed = (__HAL_TIM_GET_COUNTER(&TimHandle) - TickBase) / TIMER_COUNT_PER_TICK;
 
-    tmrcnt = __HAL_TIM_GET_COUNTER(&TimHandle);                 /* Get the timer counter value.                         */
-
-    if (__HAL_TIM_GET_FLAG(&TimHandle, TIM_FLAG_UPDATE)) {      /* Counter value already overflowed.                    */
-        return (TickDelta);
+    if (elapsed > TickDelta) {                                  /* Tick interrupt is pending, don't run past it.        */
+        elapsed = TickDelta;
     }
 
-    tmrcnt = TIMER_TO_OSTICK(tmrcnt);                           /* Otherwise, the value we read is valid.               */
+    TickElapsed = (OS_TICK)elapsed;                             /* See 'LOCAL VARIABLES  Note #2'.                      */
 
-    return ((OS_TICK)tmrcnt);
+    return ((OS_TICK)elapsed);
 }
 
 
@@ -387,20 +453,23 @@ OS_TICK  OS_DynTickSet (OS_TICK  ticks)
     CPU_INT32U  tmrcnt;
 
 
-    tmrcnt = OSTICK_TO_TIMER(ticks);
+    TickBase   += TickElapsed * TIMER_COUNT_PER_TICK;           /* The kernel has consumed the ticks last reported.     */
+    TickElapsed = 0u;
 
-    if ((tmrcnt >= TIMER_COUNT_MAX) ||                          /* If the delay exceeds our timer's capacity,       ... */
-        (tmrcnt ==              0u)) {                          /* ... or the kernel wants an indefinite delay.         */
-        tmrcnt = TIMER_COUNT_MAX;                               /* Count as many ticks as we are able.                  */
+    if ((ticks > TIMER_TICK_MAX) ||                             /* If the delay exceeds our timer's capacity,       ... */
+        (ticks ==            0u)) {                             /* ... or the kernel wants an indefinite delay.         */
+        ticks = TIMER_TICK_MAX;                                 /* Count as many ticks as we are able.                  */
     }
 
-    TickDelta  = TIMER_TO_OSTICK(tmrcnt);                       /* Convert the timer count into OS_TICK units.          */
+    TickDelta = ticks;
+    tmrcnt    = TickDelta * TIMER_COUNT_PER_TICK;
+
+    __HAL_TIM_SET_COMPARE(&TimHandle, TIM_CHANNEL_1, TickBase + tmrcnt);
+    __HAL_TIM_CLEAR_IT   (&TimHandle, TIM_IT_CC1);              /* Clear the last delay's interrupt.                    */
 
-    HAL_TIM_Base_Stop       (&TimHandle);                       /* Stop the Timer count generation.                     */
-    __HAL_TIM_CLEAR_IT      (&TimHandle, TIM_IT_UPDATE);        /* Clear the last delay's interrupt.                    */
-    __HAL_TIM_SET_AUTORELOAD(&TimHandle,        tmrcnt);        /* Re-configure auto-reload register and period.        */
-    __HAL_TIM_SET_COUNTER   (&TimHandle,            0u);        /* Reset the timer counter value                        */
-    HAL_TIM_Base_Start      (&TimHandle);                       /* Start the Timer count generation.                    */
+    if ((__HAL_TIM_GET_COUNTER(&TimHandle) - TickBase) >= tmrcnt) {
+        TimHandle.Instance->EGR = TIM_EGR_CC1G;                 /* Deadline already passed, interrupt right away.       */
+    }
 
     return (TickDelta);                                         /* Return the number ticks that will elapse before  ... */
                                                                 /* ... the next interrupt.                              */
@@ -433,11 +502,15 @@ void  TIM5_IRQHandler(void)
     OSIntEnter();
     CPU_CRITICAL_EXIT();
 
-	if((TIM5->SR & TIM_FLAG_UPDATE) != RESET)
-	{
-		TIM5->SR = ~ TIM_FLAG_UPDATE;
-	    OSTimeDynTick(TickDelta);                                   /* Next delta will be set by the kernel.                */
-	}
+    if ((TIM5->SR & TIM_FLAG_CC1) != RESET) {
+        TIM5->SR = ~TIM_FLAG_CC1;
+                                                                /* Ignore a match the kernel has already accounted for. */
+        if ((TIM5->CNT - TickBase) >= (TickDelta * TIMER_COUNT_PER_TICK)) {
+            TickBase   += TickDelta * TIMER_COUNT_PER_TICK;
+            TickElapsed = 0u;
+            OSTimeDynTick(TickDelta);                           /* Next delta will be set by the kernel.                */
+        }
+    }
 
     OSIntExit();
 }
@@ -17,6 +17,7 @@
 #include "bsp_os.h"
 #include "app_lcd.h"
 #include "app_dbg.h"
+#include "app_perf.h"
 #include "lwip.h"
 
 /* -------------------------------接口函数---------------------------- */
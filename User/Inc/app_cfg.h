@@ -39,15 +39,22 @@
 /* -------------------------------功能开关---------------------------- */
 #define APP_CFG_DBG_TMR                     0                   //调试用软件定时器，确定系统是否正常运行
 #define APP_CFG_DBG_LCD                     1                   //通过LCD屏幕输出调试信息
+#define APP_CFG_PERF_IPERF                  0                   //lwiperf TCP服务器，测量吞吐量(见app_perf.c)
+#define APP_CFG_PERF_PROT                   0                   //memp_malloc/memp_free的CPU周期数(见app_perf.c)
+#define APP_CFG_PERF_TIMER                  0                   //OSTimeDly和sys_timeout的定时误差(见app_perf.c)
+#define APP_CFG_PERF_CHKSUM                 0                   //校验和(含armcc汇编)与参考实现比对并测周期数(见app_perf.c)
+#define APP_CFG_IDLE_WFI                    0                   //动态节拍模式下空闲任务用WFI睡眠，打开后OSStatTaskCPUUsage无效
 
 /* -----------------------------任务堆栈尺寸-------------------------- */
 #define APP_CFG_TASK_START_STK_SIZE         512u
 #define APP_CFG_TASK_ETH_STK_SIZE         512u
+#define APP_CFG_TASK_PERF_STK_SIZE          256u
 
 
 
 /* ------------------------------任务优先级--------------------------- */
 #define APP_CFG_TASK_START_PRIO             ((OS_PRIO)(OS_CFG_PRIO_MAX-4u))
 #define APP_CFG_TASK_ETH_PRIO               2
+#define APP_CFG_TASK_PERF_PRIO              4
 
 #endif  /* __APP_CFG_H */
@@ -0,0 +1,100 @@
+/*
+  ******************************************************************************
+  * @file           : app_perf.h
+  * @brief          : 性能测试接口
+  ******************************************************************************
+  * @attention
+  *
+  * 测试由app_cfg.h中的APP_CFG_PERF_xxx打开，结果保存在全局变量中，用调试器查看
+  *
+  ******************************************************************************
+  */
+
+#ifndef __APP_PERF_H
+#define __APP_PERF_H
+
+#include "app_cfg.h"
+#include "lwip.h"
+
+/* -------------------------------类型定义---------------------------- */
+#if APP_CFG_PERF_IPERF > 0
+/* lwiperf吞吐量测试结果 */
+typedef struct
+{
+  uint8_t   HwChecksum;       //编译时的CHECKSUM_BY_HARDWARE，区分两次测试
+  uint32_t  Count;            //完成的测试次数
+  uint32_t  Aborted;          //中途断开的测试次数
+  uint32_t  Bytes;            //最近一次测试传输的字节数
+  uint32_t  Ms;               //最近一次测试的持续时间(ms)
+  uint32_t  Kbps;             //最近一次测试的带宽(kbit/s)
+  uint32_t  KbpsMax;          //所有测试中的最大带宽(kbit/s)
+  uint16_t  CPUUsageMax;      //最近一次测试结束时的最大CPU使用率(0.01%)
+} App_PerfIperfTypedef;
+
+extern App_PerfIperfTypedef App_PerfIperf;
+#endif
+
+#if APP_CFG_PERF_PROT > 0
+/* 一种操作的CPU周期数(DWT CYCCNT)，已减去读计数器本身的开销 */
+typedef struct
+{
+  uint32_t  Min;
+  uint32_t  Max;
+  uint32_t  Avg;
+} App_PerfCyclesTypedef;
+
+/* SYS_ARCH_PROTECT开销测试结果 */
+typedef struct
+{
+  uint8_t                ProtCritical;   //编译时的SYS_ARCH_PROT_CRITICAL，区分两次测试
+  uint32_t               Loops;          //测量次数
+  App_PerfCyclesTypedef  Prot;           //一对SYS_ARCH_PROTECT/SYS_ARCH_UNPROTECT
+  App_PerfCyclesTypedef  Alloc;          //memp_malloc(MEMP_PBUF)
+  App_PerfCyclesTypedef  Free;           //memp_free(MEMP_PBUF)
+} App_PerfProtTypedef;
+
+extern App_PerfProtTypedef App_PerfProt;
+#endif
+
+#if APP_CFG_PERF_TIMER > 0
+/* 定时误差(us) = 实际唤醒时间 - 要求的到期时间 */
+typedef struct
+{
+  uint32_t  Count;            //测量次数
+  int32_t   ErrMin;
+  int32_t   ErrMax;
+  int32_t   ErrAvg;
+  int64_t   ErrSum;           //误差累加值，用于求平均值
+} App_PerfLatencyTypedef;
+
+/* 定时精度测试结果 */
+typedef struct
+{
+  uint8_t                 DynTick;    //编译时的OS_CFG_DYN_TICK_EN，区分两次测试
+  uint8_t                 IdleWfi;    //编译时的APP_CFG_IDLE_WFI
+  App_PerfLatencyTypedef  Dly;        //OSTimeDly
+  App_PerfLatencyTypedef  Timeout;    //sys_timeout，回调在tcpip_thread中执行
+} App_PerfTimerTypedef;
+
+extern App_PerfTimerTypedef App_PerfTimer;
+#endif
+
+#if APP_CFG_PERF_CHKSUM > 0
+/* 校验和自检和开销测试结果 */
+typedef struct
+{
+  uint32_t  Cases;            //比对次数
+  uint32_t  Failed;           //LWIP_CHKSUM和参考实现结果不同的次数，应为0
+  uint32_t  CopyFailed;       //LWIP_CHKSUM_COPY返回值、复制的数据或保护字节错误的次数，应为0
+  uint32_t  CyclesRef;        //参考实现求APP_PERF_CHKSUM_LEN字节的周期数(取最小值)
+  uint32_t  Cycles;           //LWIP_CHKSUM
+  uint32_t  CyclesCopy;       //LWIP_CHKSUM_COPY
+} App_PerfChksumTypedef;
+
+extern App_PerfChksumTypedef App_PerfChksum;
+#endif
+
+/* -------------------------------接口函数---------------------------- */
+void App_PerfStart(void);
+
+#endif  /* __APP_PERF_H */
@@ -70,6 +70,11 @@
 #define TCPIP_THREAD_PRIO 1     //default 24，FreeRTOS中数字越大优先级越高，uCOS-III中正好相反
 /*----- Value in opt.h for TCPIP_MBOX_SIZE: 0 -----*/
 #define TCPIP_MBOX_SIZE 6
+/* tcpip_thread收包快速通道：收到的帧放进深度为TCPIP_MBOX_HI_SIZE的高优先级队列，先于API调用和回调处理，
+ * 定时器请求等其他消息仍按顺序走普通队列。深度取接收描述符数，ETH_RXBUFNB带类型转换不能用在#if中，
+ * 所以另用LWIP_TCPIP_MBOX_HI作开关 */
+#define LWIP_TCPIP_MBOX_HI 1
+#define TCPIP_MBOX_HI_SIZE ETHIF_RX_DESC_MAX
 /*----- Value in opt.h for SLIPIF_THREAD_STACKSIZE: 0 -----*/
 #define SLIPIF_THREAD_STACKSIZE 1024
 /*----- Value in opt.h for SLIPIF_THREAD_PRIO: 1 -----*/
@@ -110,7 +115,106 @@
 #define CHECKSUM_CHECK_ICMP6 1
 /*-----------------------------------------------------------------------------*/
 /* USER CODE BEGIN 1 */
-
+/*----- ethernetif驱动配置 -----*/
+/* 接收零拷贝：DMA接收缓冲区以pbuf_custom的形式直接交给协议栈，pbuf释放时缓冲区回到RX_POOL。
+ * ETHIF_RX_BUF_CNT为接收缓冲区总数，应大于ETH_RXBUFNB，多出来的部分用于在协议栈持有缓冲区时
+ * 给描述符补充新缓冲区 */
+#define ETHIF_RX_ZERO_COPY 0
+#define ETHIF_RX_BUF_CNT (2 * ETHIF_RX_DESC_MAX)
+/* 发送零拷贝：pbuf链的每一段直接挂到一个发送描述符上，DMA发送完成后在以太网任务中释放pbuf。
+ * DMA无法访问的内存(CCM、Flash)或者PBUF_REF这类可能被修改的数据仍然拷贝到Tx_Buff发送 */
+#define ETHIF_TX_ZERO_COPY 0
+/* 批量接收：接收中断到来后关闭DMA接收中断，一次加锁最多处理ETHIF_RX_BUDGET帧，
+ * 接收队列取空后才重新打开中断。用完预算时以太网任务延时一个节拍，避免收包风暴
+ * 时低优先级任务得不到运行 */
+#define ETHIF_RX_BATCH 0
+#define ETHIF_RX_BUDGET 8
+/* 描述符环深度：描述符和缓冲区按ETHIF_RX_DESC_MAX/ETHIF_TX_DESC_MAX静态分配，实际深度默认用满，
+ * 可以在netif_add()之前调用ethernetif_set_ring_size()减小。ETH_RingStats记录环的最高占用、
+ * RBUS/TUS次数和丢帧数，据此调整深度。
+ * ETHIF_DMA_SECTION用于把描述符和缓冲区放到分散加载文件指定的区域，
+ * 例如 __attribute__((section("ETH_DMA_RAM")))，必须是以太网DMA能访问的SRAM1/SRAM2 */
+#define ETHIF_RX_DESC_MAX ETH_RXBUFNB
+#define ETHIF_TX_DESC_MAX ETH_TXBUFNB
+#define ETHIF_DMA_SECTION
+/* 发送队列：发送描述符都被DMA占用时帧先放进长度为ETHIF_TX_QUEUE_LEN的队列，发送完成中断
+ * 唤醒以太网任务后按顺序发出，避免low_level_output()返回ERR_USE丢帧。为0时不使用队列 */
+#define ETHIF_TX_QUEUE_LEN 0
+/* PTP硬件时间戳：打开MAC的IEEE 1588时间戳单元，收发的每一帧都记录硬件时间戳，
+ * 按pbuf保存在长度为ETHIF_PTP_TS_CNT的记录表中，用ethernetif_ptp_get_rx/tx_timestamp()查询，
+ * ethernetif_ptp_xxx_time()/adjust_freq()读取和校正PTP系统时间 */
+#define ETHIF_PTP 0
+#define ETHIF_PTP_TS_CNT 8
+/* 接收中断合并：每ETHIF_RX_COALESCE_FRAMES帧产生一次接收中断，帧数不足时由DMA接收状态看门狗
+ * 在ETHIF_RX_COALESCE_USEC微秒后产生中断。运行时可以用ethernetif_set_rx_coalesce()修改，
+ * ETH_RingStats中的RxIrq/RxFrames用来比较中断次数和收到的帧数 */
+#define ETHIF_RX_COALESCE 0
+#define ETHIF_RX_COALESCE_FRAMES 2
+#define ETHIF_RX_COALESCE_USEC 100
+/* PHY连接监测：ethlink_thread每ETHIF_LINK_POLL_MS毫秒读取一次PHY状态，插拔网线时更新netif的
+ * 连接状态，并按自动协商结果设置MAC的速率和双工模式，不重新初始化MAC */
+#define ETHIF_LINK_MONITOR 1
+#define ETHIF_LINK_POLL_MS 500
+/* 组播过滤：打开LWIP_IGMP或LWIP_IPV6_MLD后，驱动用MAC的64位哈希表过滤组播帧，加入/退出组时
+ * 由igmp_mac_filter/mld_mac_filter回调更新，只接收已加入组的组播帧，不需要额外配置 */
+/* 硬件校验和：CHECKSUM_BY_HARDWARE为1时由MAC生成IP/TCP校验和，检查IP/TCP/UDP/ICMP校验和。
+ * MAC不给IP分片插入校验和，可能分片的UDP和ICMP仍由软件生成。
+ * 每个网卡单独控制软件校验和，只有以太网卡跳过软件计算，回环等其他网卡不受影响。
+ * MAC不检查IP分片的负载，分片重组后的数据报仍由协议栈检查 */
+#if CHECKSUM_BY_HARDWARE
+#define LWIP_CHECKSUM_CTRL_PER_NETIF 1
+#endif
+/* 软件校验和时驱动把接收帧拷贝到pbuf的同时求和，记录在每个pbuf中，TCP/UDP/ICMP校验直接使用，
+ * 不再读一遍数据。零拷贝接收没有拷贝过程，不使用 */
+#define LWIP_CHECKSUM_ON_RX_COPY (!CHECKSUM_BY_HARDWARE && !ETHIF_RX_ZERO_COPY)
+/*----- sys_arch配置 -----*/
+/* 邮箱环形缓冲区的最大长度，不能小于TCPIP_MBOX_SIZE + TCPIP_MBOX_HI_SIZE和DEFAULT_xxx_MBOX_SIZE。
+ * 邮箱不再使用OS_Q，不占用uCOS的全局消息池 */
+#define SYS_MBOX_SIZE_MAX (TCPIP_MBOX_SIZE + TCPIP_MBOX_HI_SIZE)
+/* SYS_ARCH_PROTECT(内存池分配释放、pbuf引用计数等)使用uC-CPU的临界区，用BASEPRI屏蔽内核管理的中断，
+ * 可以嵌套，也可以在中断中使用。为0时使用uCOS互斥量，不能在中断中使用 */
+#define SYS_ARCH_PROT_CRITICAL 1
+/* netconn/socket API使用每个任务一个的信号量等待tcpip_thread完成操作，保存在uCOS任务寄存器中，
+ * 需要OS_CFG_TASK_REG_TBL_SIZE > 0 */
+#define LWIP_NETCONN_SEM_PER_THREAD 1
+/* sys_thread_new()的任务槽表：每项SYS_THREAD_SLOT(任务名, 栈大小(单位CPU_STK))是一个静态的TCB和任务栈，
+ * 不使用堆。任务占用表中同名的槽，栈大小以表为准；任务名为NULL的是通用槽，给表中没有列出的任务
+ * (lwiperf的socket版本、netbiosns等)使用，栈不能小于调用者要求的stacksize。以太网收发任务直接调用
+ * OSTaskCreate，不在表中。增加slipif、PPP等任务时在表中加一项，没有可用的槽时sys_thread_new()停机。
+ * sys_arch_thread_stk_chk()读取每个槽的栈使用量。
+ * SYS_THREAD_SECTION用于把TCB和任务栈放到分散加载文件指定的区域 */
+#define SYS_THREAD_SLOTS \
+  SYS_THREAD_SLOT(TCPIP_THREAD_NAME, TCPIP_THREAD_STACKSIZE) \
+  SYS_THREAD_SLOT(NULL, DEFAULT_THREAD_STACKSIZE)
+#define SYS_THREAD_SECTION
+/* sys_now_us()微秒时钟使用TIM2，TCP的RTT用它测量，平滑后的RTT保存在pcb->srtt_us中，
+ * RTO仍然按TCP慢定时器的节拍计算 */
+#define LWIP_TCP_RTT_US 1
+/* 为1时在SysArchObjDbg中统计信号量、邮箱的创建删除次数和对已删除对象的操作次数，调试泄漏时打开 */
+#define SYS_ARCH_OBJ_DBG 0
+/*----- 内存放置 -----*/
+/* 协议栈只有CPU访问的内存池(PCB、定时器、netconn、netbuf等)放到CCM，减少和以太网DMA争用SRAM总线。
+ * 堆(PBUF_RAM)、PBUF_POOL和驱动的接收缓冲区池要交给DMA，仍然放在SRAM1/SRAM2(LWIP_DMA_SECTION)。
+ * LWIP_CCM段由MDK-ARM/STM32F407ZG.sct放到IRAM2，超过64KB时链接报错；不用这个分散加载文件
+ * (例如SRAM目标)时LWIP_CCM段按普通ZI数据放置 */
+#if defined(__CC_ARM)
+#define LWIP_CCM_SECTION __attribute__((section("LWIP_CCM"), zero_init))
+#endif
+#define LWIP_DMA_SECTION ETHIF_DMA_SECTION
+/*----- 查找表 -----*/
+/* 为1时TCP的活动/TIME-WAIT控制块按四元组、监听控制块按本地端口建哈希表，tcp_input只查一条哈希链，
+ * 不再遍历整个链表。连接数只有MEMP_NUM_TCP_PCB个时没有必要，连接数达到几十上百时打开 */
+#define TCP_PCB_HASH 0
+#define TCP_PCB_HASH_SIZE 32
+#define TCP_LISTEN_HASH_SIZE 8
+/* 为1时UDP控制块按本地端口建哈希表，udp_input和分配端口时只查目的端口所在的哈希链，
+ * 匹配优先级(已连接优先、指定地址优先)和原来遍历udp_pcbs相同。绑定的UDP端口多时打开 */
+#define UDP_PCB_HASH 0
+#define UDP_PCB_HASH_SIZE 16
+/* 为1时ARP表按IP地址哈希分成若干组，每组ETHARP_TABLE_HASH_WAYS项，查找只在地址所在的组内进行，组满时淘汰组内最久没有使用的表项(发包和查找命中都会更新使用时间)。
+ * 默认ARP_TABLE_SIZE只有10项，没有必要；同一网段的主机有几百个时，打开并把ARP_TABLE_SIZE加大到WAYS的整数倍 */
+#define ETHARP_TABLE_HASH 0
+#define ETHARP_TABLE_HASH_WAYS 4
 /* USER CODE END 1 */
 
 #ifdef __cplusplus
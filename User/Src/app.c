@@ -10,6 +10,7 @@
   ******************************************************************************
   */
 #include "app.h"
+#include "os_app_hooks.h"
 #include "lwip/tcp.h"
 #include "lwip/ip.h"
 
@@ -54,6 +55,7 @@ void App_Start(void)
 
   /* 初始化uCOS内核 */
   OSInit(&os_err);           //初始化uCOS内核
+  App_OS_SetAllHooks();      //APP_CFG_IDLE_WFI打开时空闲任务用WFI睡眠，直到下一个中断或者节拍
 
   /* 创建一个启动任务（也就是主任务）。启动任务会创建所有的应用程序任务 */
   OSTaskCreate((OS_TCB        *)&App_StartTaskTCB,                    //任务控制块
@@ -97,6 +99,8 @@ static void App_StartTask(void *p_arg)
   CPU_Init();     /* 这个函数必须调用，关系到OS_StatTask()统计CPU使用率，关系到中断时间测量 */
   
 #if OS_CFG_STAT_TASK_EN > 0u
+  /* CPU使用率由空闲任务循环的次数计算，APP_CFG_IDLE_WFI打开后空闲任务大部分时间在睡眠，
+     统计出的使用率接近100%，不能再作为参考 */
   OSStatTaskCPUUsageInit(&os_err);
 #endif
 
@@ -185,6 +189,8 @@ void App_EthTask(void *p_arg)
 
   IP4_ADDR(&server_ip, IP_SERVER_ADDR0, IP_SERVER_ADDR1, IP_SERVER_ADDR2, IP_SERVER_ADDR3);
   LWIP_NETIFInit();
+  netconn_thread_init();      //创建本任务的netconn信号量，之后每个连接都复用它
+  App_PerfStart();            //app_cfg.h中打开的性能测试
 
   while(1)
   {
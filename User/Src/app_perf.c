@@ -0,0 +1,518 @@
+/*
+ ******************************************************************************
+ * @file           : app_perf.c
+ * @brief          : 性能测试实现
+ ******************************************************************************
+ * @attention
+ *
+ * APP_CFG_PERF_IPERF: 板子上运行lwiperf TCP服务器(端口5001)，PC上运行
+ *     iperf -c 192.168.1.122 -t 30
+ *   CHECKSUM_BY_HARDWARE分别为0和1各编译一次，比较App_PerfIperf中的带宽和CPU使用率，
+ *   就是硬件校验和前后的对比
+ *
+ * APP_CFG_PERF_PROT: 启动时用DWT周期计数器测量APP_PERF_PROT_LOOPS次SYS_ARCH_PROTECT、
+ *   memp_malloc和memp_free的周期数。SYS_ARCH_PROT_CRITICAL分别为0(uCOS互斥量)和1(临界区)
+ *   各编译一次，比较App_PerfProt，就是改为临界区前后的对比
+ *
+ * APP_CFG_PERF_TIMER: 创建一个测试任务，依次用OSTimeDly和sys_timeout延时APP_PERF_TIMER_DLY_TAB中
+ *   的毫秒数，用sys_now_us()记录实际唤醒时间与要求的到期时间之差。节拍为1ms，延时从节拍中间开始，
+ *   理想的误差在(-1000, 0]us之间，超出的部分就是唤醒延迟。OS_CFG_DYN_TICK_EN分别为0和1各编译一次，
+ *   比较App_PerfTimer中的最大和平均误差，就是动态节拍前后的对比
+ *
+ * APP_CFG_PERF_CHKSUM: 启动时用随机数据、源和目的地址的各种对齐、不同长度比对LWIP_CHKSUM/
+ *   LWIP_CHKSUM_COPY和逐字节的参考实现，App_PerfChksum.Failed和CopyFailed应为0。
+ *   主机上的Lwip-2.1.2/test/test_chksum.c只能测C实现，armcc的汇编实现靠这里验证。
+ *   同时测量APP_PERF_CHKSUM_LEN字节的周期数
+ *
+ ******************************************************************************
+ */
+
+#include "app_perf.h"
+#include "lwip/tcpip.h"
+#if APP_CFG_PERF_IPERF > 0
+#include "lwip/apps/lwiperf.h"
+#endif
+#if APP_CFG_PERF_PROT > 0
+#include "lwip/memp.h"
+#endif
+#if (APP_CFG_PERF_PROT > 0) || (APP_CFG_PERF_TIMER > 0)
+#include "lwip/sys.h"
+#endif
+#if APP_CFG_PERF_TIMER > 0
+#include "lwip/timeouts.h"
+#endif
+#if APP_CFG_PERF_CHKSUM > 0
+#include "lwip/inet_chksum.h"
+#include <string.h>
+#endif
+
+/* -------------------------------宏定义------------------------------ */
+#if (APP_CFG_PERF_PROT > 0) || (APP_CFG_PERF_CHKSUM > 0)
+#if (CPU_CFG_TS_TMR_EN != DEF_ENABLED)
+#error "APP_CFG_PERF_PROT/APP_CFG_PERF_CHKSUM require CPU_TS_TmrRd() (DWT cycle counter)"
+#endif
+#endif
+#if APP_CFG_PERF_PROT > 0
+#define APP_PERF_PROT_LOOPS                 1000u
+#endif
+#if APP_CFG_PERF_CHKSUM > 0
+#define APP_PERF_CHKSUM_LEN                 1460u     //一个TCP满载报文段
+#define APP_PERF_CHKSUM_MAX_LEN             1514u
+#define APP_PERF_CHKSUM_OFFSET              4u        //源和目的地址覆盖0~3的所有对齐
+#define APP_PERF_CHKSUM_GUARD               4u        //目的缓冲区前后的保护字节
+#define APP_PERF_CHKSUM_GUARD_BYTE          0xA5u
+#define APP_PERF_CHKSUM_RANDOM              2000u     //随机长度的比对次数
+#endif
+#if APP_CFG_PERF_TIMER > 0
+#define APP_PERF_TIMER_SAMPLES              200u
+#define APP_PERF_TIMER_DLY_TAB              {1u, 3u, 10u, 37u, 100u}
+#endif
+
+/* -------------------------------全局变量---------------------------- */
+#if APP_CFG_PERF_IPERF > 0
+App_PerfIperfTypedef App_PerfIperf;
+#endif
+#if APP_CFG_PERF_PROT > 0
+App_PerfProtTypedef App_PerfProt;
+#endif
+#if APP_CFG_PERF_TIMER > 0
+App_PerfTimerTypedef App_PerfTimer;
+#endif
+#if APP_CFG_PERF_CHKSUM > 0
+App_PerfChksumTypedef App_PerfChksum;
+#endif
+
+/* -------------------------------局部变量---------------------------- */
+#if APP_CFG_PERF_TIMER > 0
+static OS_TCB   App_PerfTaskTCB;
+static CPU_STK  App_PerfTaskStk[APP_CFG_TASK_PERF_STK_SIZE];
+
+static const uint32_t App_PerfTimerDly[] = APP_PERF_TIMER_DLY_TAB;
+static uint32_t App_PerfTimeoutDue;     //sys_timeout要求的到期时间(us)
+
+static void App_PerfTimeoutHandler(void *arg);
+#endif
+#if APP_CFG_PERF_CHKSUM > 0
+static u8_t App_PerfChksumSrc[APP_PERF_CHKSUM_OFFSET + APP_PERF_CHKSUM_MAX_LEN];
+static u8_t App_PerfChksumDst[APP_PERF_CHKSUM_GUARD + APP_PERF_CHKSUM_OFFSET + APP_PERF_CHKSUM_MAX_LEN + APP_PERF_CHKSUM_GUARD];
+#endif
+
+/* -------------------------------局部函数---------------------------- */
+#if APP_CFG_PERF_IPERF > 0
+/*
+*********************************************************************************************************
+*	函    数: App_PerfIperfReport
+*	说    明: lwiperf每次测试结束后的回调，在tcpip_thread中执行，记录测试结果
+*	形    参: 见lwiperf_report_fn
+*	返    回: 无
+*********************************************************************************************************
+*/
+static void App_PerfIperfReport(void *arg, enum lwiperf_report_type report_type,
+                                const ip_addr_t *local_addr, u16_t local_port,
+                                const ip_addr_t *remote_addr, u16_t remote_port,
+                                u32_t bytes_transferred, u32_t ms_duration, u32_t bandwidth_kbitpsec)
+{
+  (void)arg;
+  (void)local_addr;
+  (void)local_port;
+  (void)remote_addr;
+  (void)remote_port;
+
+  if (report_type != LWIPERF_TCP_DONE_SERVER)
+  {
+    App_PerfIperf.Aborted++;
+    return;
+  }
+
+  App_PerfIperf.Count++;
+  App_PerfIperf.Bytes = bytes_transferred;
+  App_PerfIperf.Ms = ms_duration;
+  App_PerfIperf.Kbps = bandwidth_kbitpsec;
+  if (bandwidth_kbitpsec > App_PerfIperf.KbpsMax)
+  {
+    App_PerfIperf.KbpsMax = bandwidth_kbitpsec;
+  }
+#if OS_CFG_STAT_TASK_EN > 0u
+  App_PerfIperf.CPUUsageMax = OSStatTaskCPUUsageMax;
+#endif
+}
+
+/*
+*********************************************************************************************************
+*	函    数: App_PerfIperfStart
+*	说    明: 启动lwiperf服务器，lwiperf使用raw API，必须在tcpip_thread中调用
+*	形    参: arg       未使用
+*	返    回: 无
+*********************************************************************************************************
+*/
+static void App_PerfIperfStart(void *arg)
+{
+  (void)arg;
+  lwiperf_start_tcp_server_default(App_PerfIperfReport, NULL);
+}
+#endif  /* APP_CFG_PERF_IPERF */
+
+#if APP_CFG_PERF_PROT > 0
+/*
+*********************************************************************************************************
+*	函    数: App_PerfCyclesAdd
+*	说    明: 累计一次测量的周期数，sum用于最后求平均值
+*	形    参: p_cyc     统计结果
+*	          cycles    本次测量的周期数
+*	          p_sum     周期数累加值
+*	返    回: 无
+*********************************************************************************************************
+*/
+static void App_PerfCyclesAdd(App_PerfCyclesTypedef *p_cyc, uint32_t cycles, uint32_t *p_sum)
+{
+  if (cycles < p_cyc->Min)
+  {
+    p_cyc->Min = cycles;
+  }
+  if (cycles > p_cyc->Max)
+  {
+    p_cyc->Max = cycles;
+  }
+  *p_sum += cycles;
+}
+
+/*
+*********************************************************************************************************
+*	函    数: App_PerfProtRun
+*	说    明: 测量SYS_ARCH_PROTECT和内存池分配释放的周期数。在任务中运行，中断会使Max偏大，
+*	          比较时以Min和Avg为准
+*	形    参: 无
+*	返    回: 无
+*********************************************************************************************************
+*/
+static void App_PerfProtRun(void)
+{
+  CPU_TS_TMR t0, t1, t2;
+  uint32_t overhead;
+  uint32_t sum_prot = 0, sum_alloc = 0, sum_free = 0;
+  uint32_t i;
+  void *mem;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  /* 连续读两次计数器的差就是测量本身的开销 */
+  t0 = CPU_TS_TmrRd();
+  t1 = CPU_TS_TmrRd();
+  overhead = (uint32_t)(t1 - t0);
+
+  App_PerfProt.ProtCritical = SYS_ARCH_PROT_CRITICAL;
+  App_PerfProt.Prot.Min = App_PerfProt.Alloc.Min = App_PerfProt.Free.Min = DEF_INT_32U_MAX_VAL;
+  App_PerfProt.Prot.Max = App_PerfProt.Alloc.Max = App_PerfProt.Free.Max = 0;
+
+  for (i = 0; i < APP_PERF_PROT_LOOPS; i++)
+  {
+    t0 = CPU_TS_TmrRd();
+    SYS_ARCH_PROTECT(lev);
+    SYS_ARCH_UNPROTECT(lev);
+    t1 = CPU_TS_TmrRd();
+    App_PerfCyclesAdd(&App_PerfProt.Prot, (uint32_t)(t1 - t0) - overhead, &sum_prot);
+
+    t0 = CPU_TS_TmrRd();
+    mem = memp_malloc(MEMP_PBUF);
+    t1 = CPU_TS_TmrRd();
+    if (mem == NULL)
+    {
+      break;
+    }
+    memp_free(MEMP_PBUF, mem);
+    t2 = CPU_TS_TmrRd();
+    App_PerfCyclesAdd(&App_PerfProt.Alloc, (uint32_t)(t1 - t0) - overhead, &sum_alloc);
+    App_PerfCyclesAdd(&App_PerfProt.Free, (uint32_t)(t2 - t1) - overhead, &sum_free);
+  }
+
+  App_PerfProt.Loops = i;
+  if (i > 0)
+  {
+    App_PerfProt.Prot.Avg = sum_prot / i;
+    App_PerfProt.Alloc.Avg = sum_alloc / i;
+    App_PerfProt.Free.Avg = sum_free / i;
+  }
+}
+#endif  /* APP_CFG_PERF_PROT */
+
+#if APP_CFG_PERF_TIMER > 0
+/*
+*********************************************************************************************************
+*	函    数: App_PerfLatencyAdd
+*	说    明: 累计一次定时误差
+*	形    参: p_lat     统计结果
+*	          due       要求的到期时间(us)
+*	          now       实际唤醒时间(us)
+*	返    回: 无
+*********************************************************************************************************
+*/
+static void App_PerfLatencyAdd(App_PerfLatencyTypedef *p_lat, uint32_t due, uint32_t now)
+{
+  int32_t err = (int32_t)(now - due);     //sys_now_us()回绕后差值仍然正确
+
+  if (p_lat->Count == 0 || err < p_lat->ErrMin)
+  {
+    p_lat->ErrMin = err;
+  }
+  if (p_lat->Count == 0 || err > p_lat->ErrMax)
+  {
+    p_lat->ErrMax = err;
+  }
+  p_lat->Count++;
+  p_lat->ErrSum += err;
+  p_lat->ErrAvg = (int32_t)(p_lat->ErrSum / (int64_t)p_lat->Count);
+}
+
+/*
+*********************************************************************************************************
+*	函    数: App_PerfTimeoutArm
+*	说    明: 记录上一次sys_timeout的误差并启动下一次，在tcpip_thread中执行
+*	形    参: arg       本次要求的延时表下标，第一次由App_PerfTimerTask传入0
+*	返    回: 无
+*********************************************************************************************************
+*/
+static void App_PerfTimeoutArm(void *arg)
+{
+  uint32_t idx = (uint32_t)arg;
+  uint32_t ms;
+
+  if (idx >= APP_PERF_TIMER_SAMPLES)
+  {
+    return;
+  }
+  ms = App_PerfTimerDly[idx % LWIP_ARRAYSIZE(App_PerfTimerDly)];
+  App_PerfTimeoutDue = sys_now_us() + ms * 1000u;
+  sys_timeout(ms, App_PerfTimeoutHandler, (void *)(idx + 1));
+}
+
+/*
+*********************************************************************************************************
+*	函    数: App_PerfTimeoutHandler
+*	说    明: sys_timeout到期回调，在tcpip_thread中执行
+*	形    参: arg       下一次的延时表下标
+*	返    回: 无
+*********************************************************************************************************
+*/
+static void App_PerfTimeoutHandler(void *arg)
+{
+  App_PerfLatencyAdd(&App_PerfTimer.Timeout, App_PerfTimeoutDue, sys_now_us());
+  App_PerfTimeoutArm(arg);
+}
+
+/*
+*********************************************************************************************************
+*	函    数: App_PerfTimerTask
+*	说    明: 定时精度测试任务，先测OSTimeDly，再把sys_timeout的测试交给tcpip_thread，然后删除自己
+*	形    参: p_arg     未使用
+*	返    回: 无
+*********************************************************************************************************
+*/
+static void App_PerfTimerTask(void *p_arg)
+{
+  OS_ERR os_err;
+  uint32_t i, ms, due;
+
+  (void)p_arg;
+
+  App_PerfTimer.DynTick = OS_CFG_DYN_TICK_EN;
+  App_PerfTimer.IdleWfi = APP_CFG_IDLE_WFI;
+
+  for (i = 0; i < APP_PERF_TIMER_SAMPLES; i++)
+  {
+    ms = App_PerfTimerDly[i % LWIP_ARRAYSIZE(App_PerfTimerDly)];
+    due = sys_now_us() + ms * 1000u;
+    OSTimeDly((OS_TICK)(ms * OS_CFG_TICK_RATE_HZ / 1000u), OS_OPT_TIME_DLY, &os_err);
+    App_PerfLatencyAdd(&App_PerfTimer.Dly, due, sys_now_us());
+  }
+
+  tcpip_callback(App_PerfTimeoutArm, (void *)0);
+  OSTaskDel((OS_TCB *)0, &os_err);
+}
+#endif  /* APP_CFG_PERF_TIMER */
+
+#if APP_CFG_PERF_CHKSUM > 0
+/*
+*********************************************************************************************************
+*	函    数: App_PerfChksumRef
+*	说    明: 参考实现，逐字节按网络字节序求16位反码和，和lwip_standard_chksum()一样返回主机字节序
+*	形    参: p         数据起始地址
+*	          len       数据长度(字节)
+*	返    回: 16位反码和
+*********************************************************************************************************
+*/
+static u16_t App_PerfChksumRef(const u8_t *p, int len)
+{
+  u32_t sum = 0;
+  int i;
+
+  for (i = 0; i + 1 < len; i += 2)
+  {
+    sum += ((u32_t)p[i] << 8) | p[i + 1];
+  }
+  if (len & 1)
+  {
+    sum += (u32_t)p[len - 1] << 8;
+  }
+  while (sum >> 16)
+  {
+    sum = (sum & 0xffffu) + (sum >> 16);
+  }
+  return lwip_htons((u16_t)sum);
+}
+
+/*
+*********************************************************************************************************
+*	函    数: App_PerfChksumCheck
+*	说    明: 比对一次LWIP_CHKSUM和LWIP_CHKSUM_COPY，检查复制的数据和目的缓冲区前后的保护字节
+*	形    参: soff      源地址偏移
+*	          doff      目的地址偏移
+*	          len       数据长度(字节)
+*	返    回: 无
+*********************************************************************************************************
+*/
+static void App_PerfChksumCheck(uint32_t soff, uint32_t doff, uint32_t len)
+{
+  const u8_t *src = App_PerfChksumSrc + soff;
+  u8_t *dst = App_PerfChksumDst + APP_PERF_CHKSUM_GUARD + doff;
+  u16_t expect;
+  uint32_t i;
+
+  App_PerfChksum.Cases++;
+  expect = App_PerfChksumRef(src, (int)len);
+  if (LWIP_CHKSUM(src, (int)len) != expect)
+  {
+    App_PerfChksum.Failed++;
+  }
+
+  memset(App_PerfChksumDst, APP_PERF_CHKSUM_GUARD_BYTE, sizeof(App_PerfChksumDst));
+  if ((LWIP_CHKSUM_COPY(dst, src, (u16_t)len) != expect) || (memcmp(dst, src, len) != 0))
+  {
+    App_PerfChksum.CopyFailed++;
+    return;
+  }
+  for (i = 0; i < APP_PERF_CHKSUM_GUARD + doff; i++)
+  {
+    if (App_PerfChksumDst[i] != APP_PERF_CHKSUM_GUARD_BYTE)
+    {
+      App_PerfChksum.CopyFailed++;
+      return;
+    }
+  }
+  for (i = APP_PERF_CHKSUM_GUARD + doff + len; i < sizeof(App_PerfChksumDst); i++)
+  {
+    if (App_PerfChksumDst[i] != APP_PERF_CHKSUM_GUARD_BYTE)
+    {
+      App_PerfChksum.CopyFailed++;
+      return;
+    }
+  }
+}
+
+/*
+*********************************************************************************************************
+*	函    数: App_PerfChksumRun
+*	说    明: 校验和自检，再测量APP_PERF_CHKSUM_LEN字节(4字节对齐)的周期数，取多次中的最小值
+*	形    参: 无
+*	返    回: 无
+*********************************************************************************************************
+*/
+static void App_PerfChksumRun(void)
+{
+  CPU_TS_TMR t0, t1;
+  uint32_t overhead, cyc;
+  uint32_t soff, doff, len, i;
+  volatile u16_t sink;
+
+  for (i = 0; i < sizeof(App_PerfChksumSrc); i++)
+  {
+    App_PerfChksumSrc[i] = (u8_t)rand();
+  }
+
+  /* 短数据覆盖所有对齐组合，首尾的单字节和半字处理、汇编的8字/4字循环和尾部循环都会走到 */
+  for (soff = 0; soff < APP_PERF_CHKSUM_OFFSET; soff++)
+  {
+    for (doff = 0; doff < APP_PERF_CHKSUM_OFFSET; doff++)
+    {
+      for (len = 0; len <= 80u; len++)
+      {
+        App_PerfChksumCheck(soff, doff, len);
+      }
+    }
+  }
+  for (i = 0; i < APP_PERF_CHKSUM_RANDOM; i++)
+  {
+    App_PerfChksumCheck((uint32_t)rand() % APP_PERF_CHKSUM_OFFSET, (uint32_t)rand() % APP_PERF_CHKSUM_OFFSET,
+                        (uint32_t)rand() % (APP_PERF_CHKSUM_MAX_LEN + 1u));
+  }
+  /* 全0xFF的和为0xFFFF，最容易暴露进位处理的错误 */
+  memset(App_PerfChksumSrc, 0xFF, sizeof(App_PerfChksumSrc));
+  App_PerfChksumCheck(0, 0, APP_PERF_CHKSUM_MAX_LEN);
+  App_PerfChksumCheck(1, 3, APP_PERF_CHKSUM_MAX_LEN - 1u);
+
+  t0 = CPU_TS_TmrRd();
+  t1 = CPU_TS_TmrRd();
+  overhead = (uint32_t)(t1 - t0);
+  App_PerfChksum.CyclesRef = App_PerfChksum.Cycles = App_PerfChksum.CyclesCopy = DEF_INT_32U_MAX_VAL;
+  for (i = 0; i < 16u; i++)
+  {
+    t0 = CPU_TS_TmrRd();
+    sink = App_PerfChksumRef(App_PerfChksumSrc, APP_PERF_CHKSUM_LEN);
+    t1 = CPU_TS_TmrRd();
+    cyc = (uint32_t)(t1 - t0) - overhead;
+    App_PerfChksum.CyclesRef = DEF_MIN(App_PerfChksum.CyclesRef, cyc);
+
+    t0 = CPU_TS_TmrRd();
+    sink = LWIP_CHKSUM(App_PerfChksumSrc, APP_PERF_CHKSUM_LEN);
+    t1 = CPU_TS_TmrRd();
+    cyc = (uint32_t)(t1 - t0) - overhead;
+    App_PerfChksum.Cycles = DEF_MIN(App_PerfChksum.Cycles, cyc);
+
+    t0 = CPU_TS_TmrRd();
+    sink = LWIP_CHKSUM_COPY(App_PerfChksumDst + APP_PERF_CHKSUM_GUARD, App_PerfChksumSrc, APP_PERF_CHKSUM_LEN);
+    t1 = CPU_TS_TmrRd();
+    cyc = (uint32_t)(t1 - t0) - overhead;
+    App_PerfChksum.CyclesCopy = DEF_MIN(App_PerfChksum.CyclesCopy, cyc);
+  }
+  (void)sink;
+}
+#endif  /* APP_CFG_PERF_CHKSUM */
+
+/*
+*********************************************************************************************************
+*	函    数: App_PerfStart
+*	说    明: 启动app_cfg.h中打开的性能测试，在网卡初始化之后调用
+*	形    参: 无
+*	返    回: 无
+*********************************************************************************************************
+*/
+void App_PerfStart(void)
+{
+#if APP_CFG_PERF_TIMER > 0
+  OS_ERR os_err;
+#endif
+
+#if APP_CFG_PERF_IPERF > 0
+  App_PerfIperf.HwChecksum = CHECKSUM_BY_HARDWARE;
+  tcpip_callback(App_PerfIperfStart, NULL);
+#endif
+#if APP_CFG_PERF_PROT > 0
+  App_PerfProtRun();
+#endif
+#if APP_CFG_PERF_CHKSUM > 0
+  App_PerfChksumRun();
+#endif
+#if APP_CFG_PERF_TIMER > 0
+  OSTaskCreate((OS_TCB        *)&App_PerfTaskTCB,
+               (CPU_CHAR      *)"App Perf task",
+               (OS_TASK_PTR    )App_PerfTimerTask,
+               (void          *)0,
+               (OS_PRIO        )APP_CFG_TASK_PERF_PRIO,
+               (CPU_STK       *)App_PerfTaskStk,
+               (CPU_STK_SIZE   )APP_CFG_TASK_PERF_STK_SIZE / 10,
+               (CPU_STK_SIZE   )APP_CFG_TASK_PERF_STK_SIZE,
+               (OS_MSG_QTY     )0,
+               (OS_TICK        )0,
+               (void          *)0,
+               (OS_OPT         )(OS_OPT_TASK_STK_CHK | OS_OPT_TASK_STK_CLR),
+               (OS_ERR        *)&os_err);
+#endif
+}
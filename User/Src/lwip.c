@@ -94,15 +94,14 @@ void  LWIP_NETIFInit(void)
 
 err_t LWIP_NETIFCheck(void)
 {
+  /* 只读取PHY状态，netif的连接状态在ethernetif_notify_conn_changed()中加锁更新 */
   ethernetif_notify_conn_changed(&gnetif);
   if(netif_is_link_up(&gnetif))
   {
-    netif_set_up(&gnetif);
     return ERR_OK;
   }
   else
   {
-    netif_set_down(&gnetif);
     return ERR_IF;
   }
 }
@@ -27,6 +27,7 @@
 #define   MICRIUM_SOURCE
 #include  <os.h>
 #include  "os_app_hooks.h"
+#include  "app_cfg.h"
 
 
 /*
@@ -119,13 +120,16 @@ void  App_OS_ClrAllHooks (void)
 *
 * Arguments  : none
 *
-* Note(s)    : none
+* Note(s)    : (1) OS_StatTask() computes the CPU usage from how often the idle task loops.  With APP_CFG_IDLE_WFI the
+*                  idle task sleeps instead of looping, so OSStatTaskCPUUsage is no longer meaningful.
 ************************************************************************************************************************
 */
 
 void  App_OS_IdleTaskHook (void)
 {
-
+#if (OS_CFG_DYN_TICK_EN > 0u) && (APP_CFG_IDLE_WFI > 0u)
+    CPU_WaitForInt();                                           /* Sleep until the next interrupt or dynamic tick.      */
+#endif
 }
 
 /*